@@ -0,0 +1,648 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "distributed.hpp"
+
+namespace {
+
+using namespace lesty;
+
+// All messages are arrays of 32-bit words in network byte order
+constexpr std::uint32_t protocol_magic = 0x4c535459; // "LSTY"
+constexpr std::uint32_t protocol_version = 1;
+
+// Coordinator to worker, sent once per connection:
+// {magic, version, width, height, spp, first sample, seed low, seed high}
+constexpr std::size_t handshake_words = 8;
+
+// Coordinator to worker: {command, x, y, width, height}
+// Worker to coordinator: {x, y, width, height} and then the RGB floats of the
+// tile row by row
+enum Command : std::uint32_t { finish = 0, render_tile = 1 };
+constexpr std::size_t job_words = 5;
+constexpr std::size_t result_header_words = 4;
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+  throw Network_error{fmt::format("{}: {}", what, std::strerror(errno))};
+}
+
+class Socket {
+public:
+  Socket() = default;
+  explicit Socket(int fd) noexcept : fd_{fd} {}
+  ~Socket()
+  {
+    close();
+  }
+
+  Socket(const Socket&) = delete;
+  auto operator=(const Socket&) -> Socket& = delete;
+  Socket(Socket&& other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+  auto operator=(Socket&& other) noexcept -> Socket&
+  {
+    if (this != &other) {
+      close();
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+
+  [[nodiscard]] auto fd() const noexcept -> int
+  {
+    return fd_;
+  }
+
+  auto close() noexcept -> void
+  {
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  auto send_words(const std::uint32_t* words, std::size_t count) const -> void
+  {
+    std::vector<std::uint32_t> buffer(words, words + count);
+    for (auto& word : buffer) {
+      word = htonl(word);
+    }
+
+    const auto* data = reinterpret_cast<const char*>(buffer.data());
+    std::size_t remaining = buffer.size() * sizeof(std::uint32_t);
+    while (remaining > 0) {
+      const auto sent = ::send(fd_, data, remaining, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw_errno("send");
+      }
+      data += sent;
+      remaining -= static_cast<std::size_t>(sent);
+    }
+  }
+
+  auto receive_words(std::uint32_t* words, std::size_t count) const -> void
+  {
+    auto* data = reinterpret_cast<char*>(words);
+    std::size_t remaining = count * sizeof(std::uint32_t);
+    while (remaining > 0) {
+      const auto received = ::recv(fd_, data, remaining, 0);
+      if (received < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw_errno("recv");
+      }
+      if (received == 0) {
+        throw Network_error{"connection closed by peer"};
+      }
+      data += received;
+      remaining -= static_cast<std::size_t>(received);
+    }
+    std::transform(words, words + count, words,
+                   [](std::uint32_t word) { return ntohl(word); });
+  }
+
+private:
+  int fd_ = -1;
+};
+
+// A parsed "unix:PATH" or "HOST:PORT" address
+struct Address {
+  bool is_unix = false;
+  std::string path; // Path of the socket, or host name
+  std::string port;
+};
+
+[[nodiscard]] auto parse_address(const std::string& address) -> Address
+{
+  constexpr std::string_view unix_prefix = "unix:";
+  if (address.starts_with(unix_prefix)) {
+    auto path = address.substr(unix_prefix.size());
+    if (path.empty() || path.size() >= sizeof(sockaddr_un::sun_path)) {
+      throw Network_error{
+          fmt::format("invalid Unix socket path \"{}\"", address)};
+    }
+    return Address{true, std::move(path), {}};
+  }
+
+  const auto colon = address.find_last_of(':');
+  if (colon == std::string::npos || colon + 1 == address.size()) {
+    throw Network_error{fmt::format(
+        "invalid address \"{}\", expect unix:PATH or HOST:PORT", address)};
+  }
+  auto host = address.substr(0, colon);
+  if (host.empty()) {
+    host = "localhost";
+  }
+  return Address{false, std::move(host), address.substr(colon + 1)};
+}
+
+[[nodiscard]] auto unix_sockaddr(const std::string& path) -> sockaddr_un
+{
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+// Calls func(socket, addrinfo) for every TCP address of the host until it
+// returns true
+template <typename Func>
+[[nodiscard]] auto for_tcp_addresses(const Address& address, bool passive,
+                                     Func func) -> Socket
+{
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  addrinfo* infos = nullptr;
+  if (const int error = ::getaddrinfo(address.path.c_str(),
+                                      address.port.c_str(), &hints, &infos);
+      error != 0) {
+    throw Network_error{fmt::format("cannot resolve {}:{}: {}", address.path,
+                                    address.port, ::gai_strerror(error))};
+  }
+
+  Socket result;
+  for (const auto* info = infos; info != nullptr; info = info->ai_next) {
+    Socket socket{::socket(info->ai_family, info->ai_socktype,
+                           info->ai_protocol)};
+    if (socket.fd() >= 0 && func(socket, *info)) {
+      result = std::move(socket);
+      break;
+    }
+  }
+  ::freeaddrinfo(infos);
+  return result;
+}
+
+// A listening socket that removes its Unix socket file when destroyed
+class Listener {
+public:
+  explicit Listener(const std::string& address_string)
+  {
+    const auto address = parse_address(address_string);
+    if (address.is_unix) {
+      const auto addr = unix_sockaddr(address.path);
+      socket_ = Socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+      ::unlink(address.path.c_str());
+      if (socket_.fd() < 0 ||
+          ::bind(socket_.fd(), reinterpret_cast<const sockaddr*>(&addr),
+                 sizeof(addr)) != 0) {
+        throw_errno(fmt::format("cannot bind to {}", address_string));
+      }
+      unix_path_ = address.path;
+    } else {
+      socket_ = for_tcp_addresses(
+          address, true, [](const Socket& socket, const addrinfo& info) {
+            const int yes = 1;
+            ::setsockopt(socket.fd(), SOL_SOCKET, SO_REUSEADDR, &yes,
+                         sizeof(yes));
+            return ::bind(socket.fd(), info.ai_addr, info.ai_addrlen) == 0;
+          });
+      if (socket_.fd() < 0) {
+        throw_errno(fmt::format("cannot bind to {}", address_string));
+      }
+    }
+
+    if (::listen(socket_.fd(), SOMAXCONN) != 0) {
+      throw_errno(fmt::format("cannot listen on {}", address_string));
+    }
+  }
+
+  ~Listener()
+  {
+    close();
+  }
+
+  Listener(const Listener&) = delete;
+  auto operator=(const Listener&) -> Listener& = delete;
+
+  // Waits for at most timeout for a new connection
+  [[nodiscard]] auto accept(std::chrono::milliseconds timeout)
+      -> std::optional<Socket>
+  {
+    pollfd poll_fd{socket_.fd(), POLLIN, 0};
+    if (::poll(&poll_fd, 1, static_cast<int>(timeout.count())) <= 0) {
+      return std::nullopt;
+    }
+    const int fd = ::accept(socket_.fd(), nullptr, nullptr);
+    if (fd < 0) {
+      return std::nullopt;
+    }
+    return Socket{fd};
+  }
+
+  // Closes the socket without removing the socket file, for forked children
+  auto close_in_child() noexcept -> void
+  {
+    socket_.close();
+    unix_path_.clear();
+  }
+
+  auto close() noexcept -> void
+  {
+    socket_.close();
+    if (!unix_path_.empty()) {
+      ::unlink(unix_path_.c_str());
+      unix_path_.clear();
+    }
+  }
+
+private:
+  Socket socket_;
+  std::string unix_path_;
+};
+
+[[nodiscard]] auto connect_to(const std::string& address_string) -> Socket
+{
+  const auto address = parse_address(address_string);
+  if (address.is_unix) {
+    const auto addr = unix_sockaddr(address.path);
+    Socket socket{::socket(AF_UNIX, SOCK_STREAM, 0)};
+    if (socket.fd() < 0 ||
+        ::connect(socket.fd(), reinterpret_cast<const sockaddr*>(&addr),
+                  sizeof(addr)) != 0) {
+      throw_errno(fmt::format("cannot connect to {}", address_string));
+    }
+    return socket;
+  }
+
+  auto socket = for_tcp_addresses(
+      address, false, [](const Socket& s, const addrinfo& info) {
+        return ::connect(s.fd(), info.ai_addr, info.ai_addrlen) == 0;
+      });
+  if (socket.fd() < 0) {
+    throw_errno(fmt::format("cannot connect to {}", address_string));
+  }
+  const int yes = 1;
+  ::setsockopt(socket.fd(), IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+  return socket;
+}
+
+// Tiles that are not rendered yet. Tiles of workers that fail are put back.
+class Tile_queue {
+public:
+  explicit Tile_queue(std::vector<TileDesc> tiles)
+      : pending_{tiles.begin(), tiles.end()}, remaining_{tiles.size()}
+  {
+  }
+
+  // Blocks until there is a tile to render, or returns nothing if all tiles
+  // are done or the queue is closed
+  [[nodiscard]] auto pop() -> std::optional<TileDesc>
+  {
+    std::unique_lock lock{mutex_};
+    condition_.wait(lock,
+                    [this] { return !pending_.empty() || done() || closed_; });
+    if (pending_.empty() || closed_) {
+      return std::nullopt;
+    }
+    const auto tile = pending_.front();
+    pending_.pop_front();
+    return tile;
+  }
+
+  auto push_back(const TileDesc& tile) -> void
+  {
+    {
+      std::scoped_lock lock{mutex_};
+      pending_.push_back(tile);
+    }
+    condition_.notify_one();
+  }
+
+  // Returns how many tiles are finished
+  auto finish_one() -> std::size_t
+  {
+    std::size_t remaining = 0;
+    {
+      std::scoped_lock lock{mutex_};
+      remaining = --remaining_;
+    }
+    if (remaining == 0) {
+      condition_.notify_all();
+    }
+    return remaining;
+  }
+
+  [[nodiscard]] auto is_done() -> bool
+  {
+    std::scoped_lock lock{mutex_};
+    return done();
+  }
+
+  // Stops handing out tiles, the tiles in flight still finish
+  auto close() -> void
+  {
+    {
+      std::scoped_lock lock{mutex_};
+      closed_ = true;
+    }
+    condition_.notify_all();
+  }
+
+private:
+  [[nodiscard]] auto done() const noexcept -> bool
+  {
+    return remaining_ == 0;
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<TileDesc> pending_;
+  std::size_t remaining_ = 0;
+  bool closed_ = false;
+};
+
+// Serves one worker connection until all tiles are done or the worker fails
+auto serve_worker(Socket socket, const Renderer& renderer, Tile_queue& queue,
+                  Image& image,
+                  const std::function<void(const Tile&)>& tick_progress)
+    -> void
+{
+  try {
+    const auto seed = renderer.seed();
+    const std::array<std::uint32_t, handshake_words> handshake = {
+        protocol_magic,
+        protocol_version,
+        static_cast<std::uint32_t>(renderer.width()),
+        static_cast<std::uint32_t>(renderer.height()),
+        static_cast<std::uint32_t>(renderer.sample_per_pixel()),
+        static_cast<std::uint32_t>(renderer.first_sample()),
+        static_cast<std::uint32_t>(seed),
+        static_cast<std::uint32_t>(seed >> 32u)};
+    socket.send_words(handshake.data(), handshake.size());
+  } catch (const Network_error&) {
+    return;
+  }
+
+  std::vector<std::uint32_t> payload;
+  while (const auto desc = queue.pop()) {
+    try {
+      const std::array<std::uint32_t, job_words> job = {
+          Command::render_tile, static_cast<std::uint32_t>(desc->start_x),
+          static_cast<std::uint32_t>(desc->start_y),
+          static_cast<std::uint32_t>(desc->width),
+          static_cast<std::uint32_t>(desc->height)};
+      socket.send_words(job.data(), job.size());
+
+      std::array<std::uint32_t, result_header_words> header{};
+      socket.receive_words(header.data(), header.size());
+      if (header[0] != job[1] || header[1] != job[2] || header[2] != job[3] ||
+          header[3] != job[4]) {
+        throw Network_error{"worker returned a different tile"};
+      }
+
+      payload.resize(desc->width * desc->height * 3);
+      socket.receive_words(payload.data(), payload.size());
+    } catch (const Network_error& e) {
+      fmt::print(stderr, "Worker lost ({}), reschedules its tile\n", e.what());
+      queue.push_back(*desc);
+      return;
+    }
+
+    Tile tile{*desc};
+    const auto* word = payload.data();
+    for (size_t j = 0; j < tile.height(); ++j) {
+      for (size_t i = 0; i < tile.width(); ++i, word += 3) {
+        tile.at(i, j) = Color{std::bit_cast<float>(word[0]),
+                              std::bit_cast<float>(word[1]),
+                              std::bit_cast<float>(word[2])};
+      }
+    }
+    // Tiles never overlap, so they can be written without a lock
+    write_tile(tile, image);
+    queue.finish_one();
+    tick_progress(tile);
+  }
+
+  try {
+    const std::array<std::uint32_t, job_words> finish_job = {Command::finish};
+    socket.send_words(finish_job.data(), finish_job.size());
+  } catch (const Network_error&) {
+  }
+}
+
+// Renders tiles for the coordinator on one connection
+auto worker_loop(Socket socket, const Scene& scene) -> void
+{
+  std::array<std::uint32_t, handshake_words> handshake{};
+  socket.receive_words(handshake.data(), handshake.size());
+  if (handshake[0] != protocol_magic || handshake[1] != protocol_version) {
+    throw Network_error{"the coordinator speaks a different protocol"};
+  }
+
+  Options options{};
+  options.width = handshake[2];
+  options.height = handshake[3];
+  options.spp = handshake[4];
+  options.first_sample = handshake[5];
+  const auto renderer =
+      create_renderers(Renderer::Type::path, options, scene.camera());
+  renderer->set_seed(std::uint64_t{handshake[6]} |
+                     (std::uint64_t{handshake[7]} << 32u));
+
+  std::vector<std::uint32_t> payload;
+  for (;;) {
+    std::array<std::uint32_t, job_words> job{};
+    socket.receive_words(job.data(), job.size());
+    if (job[0] == Command::finish) {
+      return;
+    }
+
+    // Rays of a tile outside of the film cannot be traced
+    const TileDesc desc{job[1], job[2], job[3], job[4]};
+    if (desc.width == 0 || desc.height == 0 ||
+        desc.start_x + desc.width > options.width ||
+        desc.start_y + desc.height > options.height) {
+      throw Network_error{"the coordinator sent a tile outside of the image"};
+    }
+    const auto tile = renderer->render_tile(desc, scene);
+
+    payload.assign(job.begin() + 1, job.end());
+    for (size_t j = 0; j < tile.height(); ++j) {
+      for (size_t i = 0; i < tile.width(); ++i) {
+        const auto color = tile.at(i, j);
+        payload.push_back(std::bit_cast<std::uint32_t>(color.r));
+        payload.push_back(std::bit_cast<std::uint32_t>(color.g));
+        payload.push_back(std::bit_cast<std::uint32_t>(color.b));
+      }
+    }
+    socket.send_words(payload.data(), payload.size());
+  }
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+struct Coordinator::State {
+  explicit State(const std::string& address) : listener{address} {}
+
+  Listener listener;
+  std::vector<pid_t> children; ///< Spawned workers that are not reaped yet
+};
+
+Coordinator::Coordinator(const std::string& address, const Scene& scene,
+                         std::size_t spawn_workers)
+    : state_{std::make_unique<State>(address)}
+{
+  if (spawn_workers == 0) {
+    return;
+  }
+
+  const auto thread_count = std::max<std::size_t>(
+      1, std::thread::hardware_concurrency() / spawn_workers);
+  std::fflush(stdout);
+  std::fflush(stderr);
+  for (std::size_t i = 0; i < spawn_workers; ++i) {
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      throw_errno("fork");
+    }
+    if (pid == 0) {
+      // An interrupt in the terminal only reaches the coordinator, which
+      // stops the workers when it stops handing out tiles
+      ::setpgid(0, 0);
+      std::signal(SIGINT, SIG_DFL);
+      state_->listener.close_in_child();
+      int status = 0;
+      try {
+        run_worker(address, scene, thread_count);
+      } catch (const std::exception& e) {
+        fmt::print(stderr, "Worker error: {}\n", e.what());
+        status = 1;
+      }
+      std::fflush(stdout);
+      std::fflush(stderr);
+      ::_exit(status);
+    }
+    state_->children.push_back(pid);
+  }
+}
+
+Coordinator::~Coordinator()
+{
+  state_->listener.close();
+  // Workers exit once their connections are closed
+  for (const auto child : state_->children) {
+    ::waitpid(child, nullptr, 0);
+  }
+}
+
+auto Coordinator::render(Renderer& renderer, std::stop_token stop) -> Image
+{
+  using namespace std::chrono_literals;
+
+  Tile_queue queue{renderer.tile_descs()};
+  const auto tile_count = renderer.tile_descs().size();
+  Image image(renderer.width(), renderer.height());
+
+  std::mutex progress_mutex;
+  std::size_t finished_tiles = 0;
+  const std::function<void(const Tile&)> tick_progress = [&](const Tile& tile) {
+    renderer.finish_tile(tile);
+    std::scoped_lock lock{progress_mutex};
+    ++finished_tiles;
+    renderer.set_progress(static_cast<double>(finished_tiles) /
+                          static_cast<double>(tile_count) * 100.);
+  };
+
+  auto& listener = state_->listener;
+  auto& children = state_->children;
+  std::vector<std::jthread> connections;
+  while (!queue.is_done() && !stop.stop_requested()) {
+    if (auto socket = listener.accept(100ms)) {
+      connections.emplace_back(serve_worker, std::move(*socket),
+                               std::cref(renderer), std::ref(queue),
+                               std::ref(image), std::cref(tick_progress));
+    }
+
+    // Without any spawned worker left, we keep waiting for remote workers.
+    // Only the spawned workers are reaped, other children of the process are
+    // not ours.
+    if (!children.empty()) {
+      std::erase_if(children, [](pid_t child) {
+        return ::waitpid(child, nullptr, WNOHANG) == child;
+      });
+      if (children.empty() && !queue.is_done()) {
+        throw Network_error{"all spawned workers exited before the render "
+                            "finished"};
+      }
+    }
+  }
+  queue.close();
+  connections.clear();
+
+  // Workers always render all samples of a tile, so only a stop or a crop
+  // leaves pixels with fewer samples, as in Renderer::common_sample_count
+  if (queue.is_done() && renderer.renders_whole_image()) {
+    image.set_sample_count(renderer.sample_per_pixel());
+  }
+  return image;
+}
+
+auto run_worker(const std::string& address, const Scene& scene,
+                std::size_t thread_count) -> void
+{
+  std::vector<Socket> sockets;
+  for (std::size_t i = 0; i < std::max<std::size_t>(thread_count, 1); ++i) {
+    sockets.push_back(connect_to(address));
+  }
+
+  std::vector<std::exception_ptr> errors(sockets.size());
+  {
+    std::vector<std::jthread> threads;
+    for (std::size_t i = 0; i < sockets.size(); ++i) {
+      threads.emplace_back([&, i] {
+        try {
+          worker_loop(std::move(sockets[i]), scene);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+    }
+  }
+
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+} // namespace lesty
@@ -0,0 +1,86 @@
+#ifndef LESTY_CLI_DISTRIBUTED_HPP
+#define LESTY_CLI_DISTRIBUTED_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+
+#include "image.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+
+/**
+ * @file distributed.hpp
+ * @brief Renders a frame with several worker processes
+ *
+ * A coordinator listens on an address, either "unix:PATH" for a Unix domain
+ * socket or "HOST:PORT" for TCP, and hands out tiles to the workers that
+ * connect to it. Every worker loads the same scene file by itself, and renders
+ * the tiles with the seed of the coordinator, so the merged image is the same
+ * as the one of a single process render.
+ */
+
+namespace lesty {
+
+struct Network_error : public std::runtime_error {
+  explicit Network_error(const std::string& message)
+      : std::runtime_error{message}
+  {
+  }
+};
+
+/**
+ * @brief Renders the scene by distributing its tiles to workers
+ *
+ * The local workers are forked by the constructor, which should run before
+ * the process starts any thread, since a forked child only keeps the thread
+ * that forked it.
+ */
+class Coordinator {
+public:
+  /**
+   * @brief Listens on address and forks the local workers
+   * @param spawn_workers Number of local worker processes to fork, other
+   * workers can still connect from elsewhere
+   * @throw Network_error if the address cannot be listened on
+   */
+  Coordinator(const std::string& address, const Scene& scene,
+              std::size_t spawn_workers);
+
+  /**
+   * @brief Stops listening and waits for the local workers to exit
+   */
+  ~Coordinator();
+
+  Coordinator(const Coordinator&) = delete;
+  auto operator=(const Coordinator&) -> Coordinator& = delete;
+
+  /**
+   * @brief Renders an image with the workers
+   * @param renderer Provides the image size, sample count and seed of the
+   * render, and receives the progress
+   * @param stop Once requested, no more tile is handed out and the tiles in
+   * flight are waited for
+   * @throw Network_error if all the spawned workers exit before the image is
+   * done
+   */
+  [[nodiscard]] auto render(Renderer& renderer, std::stop_token stop = {})
+      -> Image;
+
+private:
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+/**
+ * @brief Connects to a coordinator and renders tiles until it says it is done
+ * @param thread_count How many tiles are rendered at once, each of them uses
+ * its own connection
+ */
+auto run_worker(const std::string& address, const Scene& scene,
+                std::size_t thread_count) -> void;
+
+} // namespace lesty
+
+#endif // LESTY_CLI_DISTRIBUTED_HPP
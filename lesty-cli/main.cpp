@@ -1,6 +1,17 @@
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <optional>
+#include <ranges>
+#include <stop_token>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -16,9 +27,25 @@
 
 #include <fmt/format.h>
 
+#include "denoise.hpp"
+#include "heatmap.hpp"
 #include "image.hpp"
 #include "renderer.hpp"
 #include "scene_parser.hpp"
+#include "stats.hpp"
+#include "tracing.hpp"
+
+#ifdef LESTY_HAS_DISTRIBUTED
+#include "distributed.hpp"
+#endif
+
+#ifdef LESTY_HAS_PREVIEW
+#include "preview.hpp"
+#endif
+
+#ifdef LESTY_HAS_PROGRESS_STREAM
+#include "progress_stream.hpp"
+#endif
 
 #include <indicators/progress_bar.hpp>
 
@@ -40,6 +67,74 @@ template <typename Duration>
   }
 }
 
+// Inserts suffix before the extension of filename
+[[nodiscard]] auto insert_suffix(const std::string& filename,
+                                 std::string_view suffix) -> std::string
+{
+  const auto dot = filename.find_last_of('.');
+  const auto slash = filename.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash)) {
+    return fmt::format("{}{}", filename, suffix);
+  }
+  return fmt::format("{}{}{}", filename.substr(0, dot), suffix,
+                     filename.substr(dot));
+}
+
+// Inserts the frame number before the extension of filename
+[[nodiscard]] auto frame_filename(const std::string& filename,
+                                  std::size_t frame) -> std::string
+{
+  return insert_suffix(filename, fmt::format("_{:04}", frame));
+}
+
+[[nodiscard]] auto parse_tile_order(std::string_view name)
+    -> std::optional<Tile_order>
+{
+  if (name == "scanline") {
+    return Tile_order::scanline;
+  } else if (name == "center") {
+    return Tile_order::center;
+  }
+  return std::nullopt;
+}
+
+// Parses "x,y,w,h" from the top left corner of the output image, and converts
+// it to the coordinates of Image, which start from the bottom right corner
+// (see Image::output_pixel)
+[[nodiscard]] auto parse_crop(const std::string& crop, std::size_t width,
+                              std::size_t height) -> std::optional<TileDesc>
+{
+  std::array<std::size_t, 4> values{};
+  char trailing = 0;
+  if (std::sscanf(crop.c_str(), "%zu,%zu,%zu,%zu%c", &values[0], &values[1],
+                  &values[2], &values[3], &trailing) != 4) {
+    return std::nullopt;
+  }
+  const auto [x, y, w, h] = values;
+  if (w == 0 || h == 0 || x + w > width || y + h > height) {
+    return std::nullopt;
+  }
+  return TileDesc{width - (x + w), height - (y + h), w, h};
+}
+
+[[nodiscard]] auto parse_transfer(std::string_view name)
+    -> std::optional<Image::Transfer>
+{
+  if (name == "gamma") {
+    return Image::Transfer::gamma;
+  } else if (name == "linear") {
+    return Image::Transfer::linear;
+  } else if (name == "srgb") {
+    return Image::Transfer::srgb;
+  } else if (name == "reinhard") {
+    return Image::Transfer::reinhard;
+  } else if (name == "aces") {
+    return Image::Transfer::aces;
+  }
+  return std::nullopt;
+}
+
 [[nodiscard]] auto parse_cmd(int argc, char** argv) -> Options
 {
   cxxopts::Options options("lesty",
@@ -55,20 +150,74 @@ template <typename Duration>
 
   // clang-format off
   options.add_options("Renderer")
-      ("spp","Samples per pixel, only useful for algorithms that support it",cxxopts::value<size_t>()->default_value("10"));
+      ("spp","Samples per pixel, only useful for algorithms that support it",cxxopts::value<size_t>()->default_value("10"))
+      ("seed","Seed of the random numbers, renders with the same seed and settings give the same image",cxxopts::value<std::uint64_t>()->default_value("0"))
+      ("first-sample","Index of the first sample of every pixel, renders of disjoint sample ranges can be merged by lesty-merge",cxxopts::value<size_t>()->default_value("0"))
+      ("texture-memory","Memory budget of the textures in MiB, the finest mip levels of the largest textures are dropped to fit, 0 for no limit",cxxopts::value<size_t>()->default_value("0"))
+      ("crop","Only render the region x,y,width,height of the image in pixels from the top left, the rest stays black",cxxopts::value<std::string>())
+      ("tile-order","Order of the tiles: center to render the center of the image or of the crop region first, or scanline",cxxopts::value<std::string>()->default_value("center"))
+      ("geometry-memory-budget","Memory budget of baked geometry in MiB, the least recently used chunks are evicted to fit, 0 for no limit",cxxopts::value<size_t>()->default_value("0"));
   // clang-format on
 
   // clang-format off
   options.add_options("Output")
-      ("o,output", "File name of the output image", cxxopts::value<std::string>()->default_value("output.png"))
+      ("o,output", "File name of the output image (png, pfm, exr or raw)", cxxopts::value<std::string>()->default_value("output.png"))
       ("width","Width of the output image in pixels",cxxopts::value<size_t>()->default_value("800"))
-      ("height","Height of the output image in pixels",cxxopts::value<size_t>()->default_value("600"));
+      ("height","Height of the output image in pixels",cxxopts::value<size_t>()->default_value("600"))
+      ("aov","Comma separated AOVs of the first hits to write next to the output image with their name as suffix: depth, normal, albedo, primitive_id or material_id. They are written as exr for png outputs",cxxopts::value<std::string>())
+      ("denoise","Filter the noise out of the image, guided by the albedo and normals of the first hits")
+      ("tonemap","Tone mapping of png images: gamma, linear, srgb, reinhard or aces",cxxopts::value<std::string>()->default_value("gamma"))
+      ("heatmap","Write the time spent on every pixel, as false colors for png or as seconds for float formats",cxxopts::value<std::string>())
+      ("trace","Write a Chrome trace of the render phases to a file. Needs a build with LESTY_ENABLE_TRACING",cxxopts::value<std::string>())
+      ("stats","Write performance counters as JSON to a file, - for stdout. Needs a build with LESTY_ENABLE_STATS",cxxopts::value<std::string>());
+  // clang-format on
+
+  // clang-format off
+  options.add_options("Animation")
+      ("camera-path", "File of a camera path, overrides the camera path of the scene", cxxopts::value<std::string>())
+      ("frames", "Number of frames to render along the camera path, 0 to use the frame count of the path", cxxopts::value<size_t>()->default_value("0"));
+  // clang-format on
+
+#ifdef LESTY_HAS_DISTRIBUTED
+  // clang-format off
+  options.add_options("Distributed")
+      ("listen", "Coordinate a distributed render on unix:PATH or HOST:PORT", cxxopts::value<std::string>())
+      ("connect", "Render tiles for the coordinator at unix:PATH or HOST:PORT", cxxopts::value<std::string>())
+      ("spawn-workers", "Number of local worker processes to start with --listen", cxxopts::value<size_t>()->default_value("0"));
+  // clang-format on
+#endif
+
+#ifdef LESTY_HAS_PROGRESS_STREAM
+  // clang-format off
+  options.add_options("Monitoring")
+      ("progress", "Stream progress as JSON lines to fd:N or unix:PATH", cxxopts::value<std::string>())
+      ("progress-dump", "File of the partial image written on SIGUSR1 or a \"dump\" command, defaults to the output with a _partial suffix", cxxopts::value<std::string>());
   // clang-format on
+#endif
+
+#ifdef LESTY_HAS_PREVIEW
+  // clang-format off
+  options.add_options("Preview")
+      ("preview", "Keep the scene loaded, read camera updates as JSON lines from stdin, and stream progressively refined png frames to stdout");
+  // clang-format on
+#endif
 
   options.parse_positional({"input_filename"});
 
   const auto print_help = [options]() {
-    std::puts(options.help({"", "Renderer", "Output"}).c_str());
+    std::puts(options
+                  .help({"", "Renderer", "Output", "Animation",
+#ifdef LESTY_HAS_DISTRIBUTED
+                         "Distributed",
+#endif
+#ifdef LESTY_HAS_PROGRESS_STREAM
+                         "Monitoring",
+#endif
+#ifdef LESTY_HAS_PREVIEW
+                         "Preview",
+#endif
+                  })
+                  .c_str());
   };
 
   auto result = [&]() {
@@ -85,6 +234,14 @@ template <typename Duration>
     exit(0);
   }
 
+  // Before anything is printed
+  int preview_fd = -1;
+#ifdef LESTY_HAS_PREVIEW
+  if (result.count("preview")) {
+    preview_fd = reserve_stdout_for_frames();
+  }
+#endif
+
   const auto input_filename = [&]() {
     if (result.count("input_filename")) {
       return result["input_filename"].as<std::string>();
@@ -96,17 +253,404 @@ template <typename Duration>
   fmt::print("input_filename file: {}\n", input_filename);
 
   const auto spp = result["spp"].as<size_t>();
+  const auto first_sample = result["first-sample"].as<size_t>();
+  const auto seed = result["seed"].as<std::uint64_t>();
+  const auto texture_memory = result["texture-memory"].as<size_t>() << 20u;
+  const auto geometry_memory =
+      result["geometry-memory-budget"].as<size_t>() << 20u;
   const auto width = result["width"].as<size_t>();
   const auto height = result["height"].as<size_t>();
   const auto output_filename = result["output"].as<std::string>();
+  TileDesc crop{};
+  if (result.count("crop")) {
+    const auto crop_string = result["crop"].as<std::string>();
+    const auto parsed_crop = parse_crop(crop_string, width, height);
+    if (!parsed_crop) {
+      fmt::print(stderr,
+                 "Error: invalid crop region \"{}\", expect x,y,width,height "
+                 "inside the image\n",
+                 crop_string);
+      std::exit(-1);
+    }
+    crop = *parsed_crop;
+    // Preview passes are merged by their sample counts, which a cropped
+    // render does not have
+    if (preview_fd >= 0) {
+      std::fputs("Error: --crop is not supported by --preview\n", stderr);
+      std::exit(-1);
+    }
+  }
+  const auto tile_order_name = result["tile-order"].as<std::string>();
+  const auto tile_order = parse_tile_order(tile_order_name);
+  if (!tile_order) {
+    fmt::print(stderr, "Error: unknown tile order \"{}\"\n", tile_order_name);
+    std::exit(-1);
+  }
+  const auto tonemap_name = result["tonemap"].as<std::string>();
+  const auto tonemap = parse_transfer(tonemap_name);
+  if (!tonemap) {
+    fmt::print(stderr, "Error: unknown tone mapping \"{}\"\n", tonemap_name);
+    std::exit(-1);
+  }
+  const bool denoise = result.count("denoise") > 0;
+  Aov_set aovs;
+  if (result.count("aov")) {
+    const auto names = result["aov"].as<std::string>();
+    for (const auto name : std::views::split(names, ',')) {
+      const std::string_view name_view{name.begin(), name.end()};
+      const auto aov = parse_aov(name_view);
+      if (!aov) {
+        fmt::print(stderr, "Error: unknown AOV \"{}\"\n", name_view);
+        std::exit(-1);
+      }
+      aovs.insert(*aov);
+    }
+  }
+  const auto camera_path_filename =
+      result.count("camera-path") ? result["camera-path"].as<std::string>()
+                                  : std::string{};
+  const auto frame_count = result["frames"].as<size_t>();
+  const auto heatmap_filename = result.count("heatmap")
+                                    ? result["heatmap"].as<std::string>()
+                                    : std::string{};
+  const auto trace_filename = result.count("trace")
+                                  ? result["trace"].as<std::string>()
+                                  : std::string{};
+  if (!trace_filename.empty() && !tracing_enabled) {
+    std::fputs("Error: --trace needs lesty to be built with "
+               "LESTY_ENABLE_TRACING\n",
+               stderr);
+    std::exit(-1);
+  }
+  const auto stats_filename = result.count("stats")
+                                  ? result["stats"].as<std::string>()
+                                  : std::string{};
+  if (!stats_filename.empty() && !stats_enabled) {
+    std::fputs("Error: --stats needs lesty to be built with "
+               "LESTY_ENABLE_STATS\n",
+               stderr);
+    std::exit(-1);
+  }
+
+  std::string listen_address;
+  std::string connect_address;
+  std::size_t spawn_workers = 0;
+#ifdef LESTY_HAS_DISTRIBUTED
+  if (result.count("listen")) {
+    listen_address = result["listen"].as<std::string>();
+  }
+  if (result.count("connect")) {
+    connect_address = result["connect"].as<std::string>();
+  }
+  spawn_workers = result["spawn-workers"].as<size_t>();
+  if (!listen_address.empty() && !connect_address.empty()) {
+    std::fputs("Error: --listen and --connect cannot be used together\n",
+               stderr);
+    std::exit(-1);
+  }
+  if (!listen_address.empty() && !heatmap_filename.empty()) {
+    std::fputs("Error: --heatmap is not supported by distributed renders\n",
+               stderr);
+    std::exit(-1);
+  }
+  if (!listen_address.empty() && (denoise || !aovs.empty())) {
+    std::fputs("Error: --denoise and --aov are not supported by distributed "
+               "renders\n",
+               stderr);
+    std::exit(-1);
+  }
+#endif
+
+  std::string progress_target;
+  std::string progress_dump_filename;
+#ifdef LESTY_HAS_PROGRESS_STREAM
+  if (result.count("progress")) {
+    progress_target = result["progress"].as<std::string>();
+  }
+  progress_dump_filename = result.count("progress-dump")
+                               ? result["progress-dump"].as<std::string>()
+                               : insert_suffix(output_filename, "_partial");
+#endif
 
   fmt::print("width: {}, height: {}, sample size: {}\n", width, height, spp);
+  if (first_sample != 0) {
+    fmt::print("samples: {} to {}\n", first_sample, first_sample + spp - 1);
+  }
 
   return Options{.spp = spp,
+                 .first_sample = first_sample,
+                 .seed = seed,
                  .width = width,
                  .height = height,
                  .input_filename = input_filename,
-                 .output_filename = output_filename};
+                 .output_filename = output_filename,
+                 .stats_filename = stats_filename,
+                 .trace_filename = trace_filename,
+                 .heatmap_filename = heatmap_filename,
+                 .camera_path_filename = camera_path_filename,
+                 .frame_count = frame_count,
+                 .listen_address = listen_address,
+                 .connect_address = connect_address,
+                 .spawn_workers = spawn_workers,
+                 .progress_target = progress_target,
+                 .progress_dump_filename = progress_dump_filename,
+                 .texture_memory = texture_memory,
+                 .geometry_memory = geometry_memory,
+                 .tonemap = *tonemap,
+                 .aovs = aovs,
+                 .denoise = denoise,
+                 .preview_fd = preview_fd,
+                 .crop = crop,
+                 .tile_order = *tile_order};
+}
+
+[[nodiscard]] auto load_camera_path(const Options& options, const Scene& scene)
+    -> std::optional<Camera_path>
+{
+  std::optional<Camera_path> path;
+  if (!options.camera_path_filename.empty()) {
+    std::ifstream path_file{options.camera_path_filename};
+    if (!path_file.is_open()) {
+      fmt::print(stderr, "Error: cannot open file \"{}\"\n",
+                 options.camera_path_filename);
+      std::exit(2);
+    }
+    path = parse_camera_path(path_file, scene.camera());
+  } else {
+    path = scene.camera_path();
+  }
+
+  if (path && options.frame_count != 0) {
+    path = Camera_path{path->keyframes(), options.frame_count};
+  }
+  return path;
+}
+
+std::atomic<bool> interrupted = false;
+static_assert(std::atomic<bool>::is_always_lock_free,
+              "The flag is set from a signal handler");
+
+extern "C" void request_interrupt(int /*signal*/)
+{
+  interrupted = true;
+  // A second interrupt kills the process
+  std::signal(SIGINT, SIG_DFL);
+}
+
+// Stops the renders on the first SIGINT, so that the partial image is still
+// saved
+class Interrupt_watch {
+public:
+  Interrupt_watch()
+  {
+    std::signal(SIGINT, request_interrupt);
+    // Stop sources cannot be used from a signal handler
+    watcher_ = std::jthread{[this](std::stop_token done) {
+      using namespace std::chrono_literals;
+      while (!done.stop_requested()) {
+        if (interrupted) {
+          fmt::print(stderr, "\nInterrupted, stopping the render\n");
+          stop_.request_stop();
+          return;
+        }
+        std::this_thread::sleep_for(50ms);
+      }
+    }};
+  }
+
+  ~Interrupt_watch()
+  {
+    watcher_.request_stop();
+    watcher_.join();
+    std::signal(SIGINT, SIG_DFL);
+  }
+
+  Interrupt_watch(const Interrupt_watch&) = delete;
+  auto operator=(const Interrupt_watch&) -> Interrupt_watch& = delete;
+
+  [[nodiscard]] auto token() const -> std::stop_token
+  {
+    return stop_.get_token();
+  }
+
+private:
+  std::stop_source stop_;
+  std::jthread watcher_;
+};
+
+// Filters the noise of the last render with the guides it recorded
+[[nodiscard]] auto denoise_render(const Renderer& renderer, const Image& image)
+    -> Image
+{
+  const auto& aovs = renderer.aov_buffers();
+  return denoise(image, aovs.to_image(Aov::albedo),
+                 aovs.to_image(Aov::normal));
+}
+
+// Writes the AOVs of the last render that were asked for, named after the
+// output image
+auto save_aovs(const Renderer& renderer, const Options& options,
+               const std::string& output_filename) -> void
+{
+  // 8-bit images would clip the values
+  auto filename = output_filename;
+  if (filename.ends_with(".png")) {
+    filename.replace(filename.size() - 4, 4, ".exr");
+  }
+  for (const auto aov : all_aovs) {
+    if (options.aovs.contains(aov)) {
+      const auto aov_filename =
+          insert_suffix(filename, fmt::format("_{}", aov_name(aov)));
+      renderer.aov_buffers().to_image(aov).saveto(aov_filename);
+      fmt::print("Save {} to {}\n", aov_name(aov), aov_filename);
+    }
+  }
+}
+
+// Writes the per pixel costs of the last render
+auto save_heatmap(const Renderer& renderer, const std::string& filename)
+    -> void
+{
+  if (filename.ends_with(".png")) {
+    false_color_heatmap(renderer.costs())
+        .saveto(filename, Image::Transfer::linear);
+  } else {
+    renderer.costs().saveto(filename);
+  }
+  fmt::print("Save heatmap to {}\n", filename);
+}
+
+// Writes the performance counters of everything rendered so far
+auto report_stats(const Options& options,
+                  std::chrono::duration<double> elapsed_time) -> void
+{
+  if (options.stats_filename.empty()) {
+    return;
+  }
+
+  const auto json = stats_to_json(global_stats(), elapsed_time);
+  if (options.stats_filename == "-") {
+    fmt::print("{}\n", json);
+    return;
+  }
+  std::ofstream file{options.stats_filename};
+  if (!file) {
+    throw Cannot_write_file{options.stats_filename.c_str()};
+  }
+  file << json << '\n';
+  fmt::print("Save stats to {}\n", options.stats_filename);
+}
+
+auto save_trace(const Options& options) -> void
+{
+  if (!options.trace_filename.empty()) {
+    write_trace(options.trace_filename);
+    fmt::print("Save trace to {}\n", options.trace_filename);
+  }
+}
+
+#ifdef LESTY_HAS_PROGRESS_STREAM
+// Streams the progress of a frame when --progress is used
+class Progress_report {
+public:
+  explicit Progress_report(const Options& options)
+  {
+    if (!options.progress_target.empty()) {
+      stream_.emplace(options.progress_target);
+    }
+  }
+
+  auto begin_render(Renderer& renderer, std::size_t frame,
+                    std::string dump_filename) -> void
+  {
+    if (stream_) {
+      stream_->begin_render(renderer, frame, std::move(dump_filename));
+    }
+  }
+
+  auto end_render() -> void
+  {
+    if (stream_) {
+      stream_->end_render();
+    }
+  }
+
+private:
+  std::optional<Progress_stream> stream_;
+};
+#else
+class Progress_report {
+public:
+  explicit Progress_report(const Options& /*options*/) {}
+  auto begin_render(Renderer& /*renderer*/, std::size_t /*frame*/,
+                    const std::string& /*dump_filename*/) -> void
+  {
+  }
+  auto end_render() -> void {}
+};
+#endif
+
+// Renders all frames of the camera path with the already loaded scene. Only
+// the camera moves, so the BVH of the scene never needs an update.
+auto render_animation(Renderer& renderer, const Scene& scene,
+                      const Camera_path& path, const Options& options,
+                      Progress_report& progress, std::stop_token stop) -> void
+{
+  using namespace std::chrono;
+
+  const auto aspect_ratio =
+      static_cast<float>(options.width) / static_cast<float>(options.height);
+  const auto frame_count = path.frame_count();
+
+  // A frame is only reported as saved once its write succeeded
+  std::future<void> pending_save;
+  std::string pending_filename;
+  const auto finish_save = [&] {
+    if (pending_save.valid()) {
+      pending_save.get();
+      fmt::print("Save image to {}\n", pending_filename);
+    }
+  };
+
+  const auto start = system_clock::now();
+  for (std::size_t frame = 0; frame < frame_count; ++frame) {
+    renderer.set_camera(path.camera_at_frame(frame, aspect_ratio));
+
+    const auto frame_start = system_clock::now();
+    progress.begin_render(
+        renderer, frame,
+        frame_filename(options.progress_dump_filename, frame));
+    Image image = renderer.render(scene, stop);
+    progress.end_render();
+    if (options.denoise) {
+      image = denoise_render(renderer, image);
+    }
+    const auto frame_end = system_clock::now();
+    fmt::print("Frame {}/{} rendered in {}\n", frame + 1, frame_count,
+               get_elapse_time(frame_end - frame_start));
+
+    // The previous frame is written while this frame is being rendered
+    finish_save();
+    const auto filename = frame_filename(options.output_filename, frame);
+    pending_save = save_async(std::move(image), filename, options.tonemap);
+    pending_filename = filename;
+    if (renderer.record_costs()) {
+      save_heatmap(renderer, frame_filename(options.heatmap_filename, frame));
+    }
+    save_aovs(renderer, options, filename);
+    if (stop.stop_requested()) {
+      fmt::print(stderr, "Frame {} is partial, skip the remaining frames\n",
+                 frame + 1);
+      break;
+    }
+  }
+  finish_save();
+
+  const auto end = system_clock::now();
+  std::fflush(stdout);
+  fmt::print("Elapsed time: {}\n", get_elapse_time(end - start));
+  report_stats(options, end - start);
+  save_trace(options);
 }
 
 int main(int argc, char** argv)
@@ -115,6 +659,9 @@ try {
   using namespace beyond::literals;
 
   const auto options = parse_cmd(argc, argv);
+  if (!options.trace_filename.empty()) {
+    start_tracing();
+  }
 
   std::ifstream input_file{options.input_filename};
   if (!input_file.is_open()) {
@@ -122,8 +669,58 @@ try {
                options.input_filename);
     std::exit(2);
   }
-  const auto scene = parse_scene(input_file);
-  const auto renderer = lesty::create_renderers(Renderer::Type::path, options);
+  const auto scene =
+      parse_scene(input_file,
+                  std::filesystem::path{options.input_filename}.parent_path());
+  if (options.texture_memory > 0) {
+    fit_memory_budget(scene.textures(), options.texture_memory);
+  }
+  if (auto* geometry_cache = scene.geometry_cache()) {
+    geometry_cache->set_budget(options.geometry_memory);
+  }
+  const auto renderer =
+      lesty::create_renderers(Renderer::Type::path, options, scene.camera());
+
+#ifdef LESTY_HAS_PREVIEW
+  if (options.preview_fd >= 0) {
+    const auto start = std::chrono::system_clock::now();
+    run_preview(scene, options, options.preview_fd);
+    report_stats(options, std::chrono::system_clock::now() - start);
+    save_trace(options);
+    return 0;
+  }
+#endif
+
+#ifdef LESTY_HAS_DISTRIBUTED
+  if (!options.connect_address.empty()) {
+    run_worker(options.connect_address, scene,
+               std::max(std::thread::hardware_concurrency(), 1u));
+    return 0;
+  }
+#endif
+
+  const auto camera_path = load_camera_path(options, scene);
+#ifdef LESTY_HAS_DISTRIBUTED
+  if (camera_path && !options.listen_address.empty()) {
+    std::fputs("Error: --listen does not support the frames of a camera path\n",
+               stderr);
+    std::exit(-1);
+  }
+
+  // Forks the local workers before any thread is started
+  std::optional<Coordinator> coordinator;
+  if (!options.listen_address.empty()) {
+    coordinator.emplace(options.listen_address, scene, options.spawn_workers);
+  }
+#endif
+
+  Progress_report progress_report{options};
+  const Interrupt_watch interrupt_watch;
+  if (camera_path) {
+    render_animation(*renderer, scene, *camera_path, options, progress_report,
+                     interrupt_watch.token());
+    return 0;
+  }
 
   indicators::ProgressBar progress_bar{
       indicators::option::BarWidth{50},
@@ -140,14 +737,34 @@ try {
   });
 
   const auto start = std::chrono::system_clock::now();
-  const Image image = renderer->render(scene);
+  progress_report.begin_render(*renderer, 0, options.progress_dump_filename);
+#ifdef LESTY_HAS_DISTRIBUTED
+  Image image =
+      coordinator ? coordinator->render(*renderer, interrupt_watch.token())
+                  : renderer->render(scene, interrupt_watch.token());
+#else
+  Image image = renderer->render(scene, interrupt_watch.token());
+#endif
+  progress_report.end_render();
+  if (options.denoise) {
+    image = denoise_render(*renderer, image);
+  }
   const auto end = std::chrono::system_clock::now();
 
   std::fflush(stdout);
   fmt::print("Elapsed time: {}\n", get_elapse_time(end - start));
 
-  image.saveto(options.output_filename);
+  if (interrupt_watch.token().stop_requested()) {
+    fmt::print(stderr, "The image is partial\n");
+  }
+  image.saveto(options.output_filename, options.tonemap);
   fmt::print("Save image to {}\n", options.output_filename);
+  if (renderer->record_costs()) {
+    save_heatmap(*renderer, options.heatmap_filename);
+  }
+  save_aovs(*renderer, options, options.output_filename);
+  report_stats(options, end - start);
+  save_trace(options);
   return 0;
 } catch (const std::exception& e) {
   fmt::print(stderr, "Error: {}\n", e.what());
@@ -0,0 +1,224 @@
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "preview.hpp"
+#include "scene_parser.hpp"
+#include "tracing.hpp"
+
+namespace {
+
+using namespace lesty;
+
+// State shared by the thread that reads the commands and the renders
+struct Commands {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::optional<Camera_settings> camera; ///< Not yet applied camera update
+  std::size_t update_count = 0;
+  bool quit = false;
+  std::stop_source stop; ///< Stops the pass in flight
+};
+
+// Applies a line of stdin, returns false on "quit"
+auto read_command(const std::string& line, Commands& commands,
+                  Camera_settings& settings) -> bool
+{
+  if (line == "quit") {
+    return false;
+  }
+  if (line.empty()) {
+    return true;
+  }
+  try {
+    settings = parse_camera_update(line, settings);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "Warning: ignore the camera update {}: {}\n", line,
+               e.what());
+    return true;
+  }
+
+  std::scoped_lock lock{commands.mutex};
+  commands.camera = settings;
+  ++commands.update_count;
+  commands.stop.request_stop();
+  commands.changed.notify_one();
+  return true;
+}
+
+// Stdin is polled with a timeout rather than read with a blocking call, so
+// that the reader notices when the preview ends without stdin being closed
+auto read_commands(std::stop_token stop, Commands& commands,
+                   Camera_settings settings) -> void
+{
+  constexpr int poll_timeout_ms = 100;
+
+  std::string buffer;
+  bool is_open = true;
+  while (is_open && !stop.stop_requested()) {
+    ::pollfd input{STDIN_FILENO, POLLIN, 0};
+    const auto ready = ::poll(&input, 1, poll_timeout_ms);
+    if (ready == 0 || (ready < 0 && errno == EINTR)) {
+      continue;
+    }
+
+    std::array<char, 4096> chunk{};
+    const auto size =
+        ready < 0 ? -1 : ::read(STDIN_FILENO, chunk.data(), chunk.size());
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      // The last line may not end with a newline
+      if (!buffer.empty()) {
+        read_command(buffer, commands, settings);
+      }
+      break;
+    }
+
+    buffer.append(chunk.data(), static_cast<std::size_t>(size));
+    std::size_t end = 0;
+    while (is_open && (end = buffer.find('\n')) != std::string::npos) {
+      is_open = read_command(buffer.substr(0, end), commands, settings);
+      buffer.erase(0, end + 1);
+    }
+  }
+
+  std::scoped_lock lock{commands.mutex};
+  commands.quit = true;
+  commands.stop.request_stop();
+  commands.changed.notify_one();
+}
+
+// Returns false if the client is gone
+[[nodiscard]] auto write_all(int fd, const void* data, std::size_t size)
+    -> bool
+{
+  const auto* bytes = static_cast<const char*>(data);
+  std::size_t written = 0;
+  while (written < size) {
+    const auto result = ::write(fd, bytes + written, size - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += static_cast<std::size_t>(result);
+  }
+  return true;
+}
+
+[[nodiscard]] auto write_frame(int fd, const Image& image,
+                               std::size_t update_count,
+                               Image::Transfer transfer) -> bool
+{
+  LESTY_TRACE_SCOPE("write_frame");
+  const auto png = image.to_png(transfer);
+  const auto header = fmt::format(
+      R"({{"event": "frame", "update": {}, "spp": {}, "width": {}, )"
+      R"("height": {}, "bytes": {}}})"
+      "\n",
+      update_count, image.sample_count(), image.width(), image.height(),
+      png.size());
+  return write_all(fd, header.data(), header.size()) &&
+         write_all(fd, png.data(), png.size());
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto reserve_stdout_for_frames() -> int
+{
+  std::fflush(stdout);
+  const int frame_fd = ::dup(STDOUT_FILENO);
+  if (frame_fd < 0 || ::dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+    throw std::runtime_error{fmt::format(
+        "cannot redirect stdout for the preview: {}", std::strerror(errno))};
+  }
+  return frame_fd;
+}
+
+auto run_preview(const Scene& scene, const Options& options, int frame_fd)
+    -> void
+{
+  // A client that goes away should end the preview instead of killing it
+  std::signal(SIGPIPE, SIG_IGN);
+
+  // The reader is stopped and joined on every return
+  Commands commands;
+  const std::jthread reader{read_commands, std::ref(commands),
+                            scene.camera()};
+
+  // Every pass renders one more sample per pixel. Frames are only the color,
+  // so the passes record neither AOVs nor costs.
+  auto pass_options = options;
+  pass_options.spp = 1;
+  pass_options.first_sample = 0;
+  pass_options.aovs = {};
+  pass_options.denoise = false;
+  pass_options.heatmap_filename.clear();
+  const auto renderer =
+      create_renderers(Renderer::Type::path, pass_options, scene.camera());
+  const auto aspect_ratio =
+      static_cast<float>(options.width) / static_cast<float>(options.height);
+
+  Image accumulated{0, 0};
+  std::size_t update_count = 0;
+  while (true) {
+    std::stop_token stop;
+    {
+      std::unique_lock lock{commands.mutex};
+      commands.changed.wait(lock, [&] {
+        return commands.quit || commands.camera ||
+               accumulated.sample_count() < options.spp;
+      });
+      if (commands.quit) {
+        return;
+      }
+      if (commands.camera) {
+        renderer->set_camera(Camera{*commands.camera, aspect_ratio});
+        commands.camera.reset();
+        update_count = commands.update_count;
+        accumulated = Image{0, 0};
+      }
+      commands.stop = std::stop_source{};
+      stop = commands.stop.get_token();
+    }
+
+    renderer->set_first_sample(accumulated.sample_count());
+    auto pass = renderer->render(scene, stop);
+    if (stop.stop_requested()) {
+      continue;
+    }
+    if (accumulated.sample_count() == 0) {
+      accumulated = std::move(pass);
+    } else {
+      const std::array passes{std::move(accumulated), std::move(pass)};
+      accumulated = merge_sample_ranges(passes);
+    }
+
+    if (!write_frame(frame_fd, accumulated, update_count, options.tonemap)) {
+      fmt::print(stderr, "Preview client is gone: {}\n", std::strerror(errno));
+      return;
+    }
+  }
+}
+
+} // namespace lesty
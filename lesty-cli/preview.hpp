@@ -0,0 +1,45 @@
+#ifndef LESTY_CLI_PREVIEW_HPP
+#define LESTY_CLI_PREVIEW_HPP
+
+#include "renderer.hpp"
+#include "scene.hpp"
+
+/**
+ * @file preview.hpp
+ * @brief Interactive preview of a scene that stays loaded between camera
+ * changes
+ *
+ * Every line read from stdin is either a JSON object in the format of the
+ * "camera" entry of a scene file, whose entries replace the ones of the
+ * current camera, or "quit". The end of stdin also quits.
+ *
+ * The image is refined one sample per pixel at a time, up to the samples per
+ * pixel of the options. After every pass, a JSON line
+ * {"event": "frame", "update": N, "spp": S, "width": W, "height": H,
+ * "bytes": B} is written to stdout, followed by B bytes of a png image. N
+ * counts the camera updates, so that clients can drop frames of stale
+ * cameras.
+ *
+ * A camera update stops the tiles of the current pass that have not started,
+ * and the refinement restarts from one sample per pixel.
+ */
+
+namespace lesty {
+
+/**
+ * @brief Moves stdout to a new file descriptor for the frames, and sends
+ * everything else printed to stdout to stderr
+ * @return The file descriptor of the frames
+ */
+[[nodiscard]] auto reserve_stdout_for_frames() -> int;
+
+/**
+ * @brief Previews the scene until stdin is closed or reads "quit"
+ * @param frame_fd Where the frames are written
+ */
+auto run_preview(const Scene& scene, const Options& options, int frame_fd)
+    -> void;
+
+} // namespace lesty
+
+#endif // LESTY_CLI_PREVIEW_HPP
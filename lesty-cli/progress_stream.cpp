@@ -0,0 +1,283 @@
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "nlohmann/json.hpp"
+
+#include "progress_stream.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr auto heartbeat_interval = 5s;
+constexpr auto poll_interval = 100ms;
+
+std::atomic<bool> dump_requested = false;
+static_assert(std::atomic<bool>::is_always_lock_free,
+              "The flag is set from a signal handler");
+
+extern "C" void request_dump(int /*signal*/)
+{
+  dump_requested = true;
+}
+
+// Resident memory of the process from /proc, 0 if unknown
+auto resident_memory() -> std::size_t
+{
+  std::ifstream statm{"/proc/self/statm"};
+  std::size_t total_pages = 0;
+  std::size_t resident_pages = 0;
+  if (!(statm >> total_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+[[nodiscard]] auto connect_unix(const std::string& path) -> int
+{
+  sockaddr_un addr{};
+  if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error{
+        fmt::format("invalid Unix socket path \"{}\"", path)};
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&addr),
+                          sizeof(addr)) != 0) {
+    const auto error = std::strerror(errno);
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    throw std::runtime_error{
+        fmt::format("cannot connect to progress socket {}: {}", path, error)};
+  }
+  return fd;
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+Progress_stream::Progress_stream(const std::string& target)
+{
+  constexpr std::string_view fd_prefix = "fd:";
+  constexpr std::string_view unix_prefix = "unix:";
+  if (target.starts_with(fd_prefix)) {
+    try {
+      fd_ = std::stoi(target.substr(fd_prefix.size()));
+    } catch (const std::logic_error&) {
+      fd_ = -1;
+    }
+    if (fd_ < 0) {
+      throw std::runtime_error{
+          fmt::format("invalid progress file descriptor \"{}\"", target)};
+    }
+  } else if (target.starts_with(unix_prefix)) {
+    fd_ = connect_unix(target.substr(unix_prefix.size()));
+    owns_fd_ = true;
+    is_socket_ = true;
+  } else {
+    throw std::runtime_error{fmt::format(
+        "invalid progress target \"{}\", expect fd:N or unix:PATH", target)};
+  }
+
+  // A scheduler that goes away should not kill the render
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGUSR1, request_dump);
+
+  monitor_ = std::thread{[this] { monitor(); }};
+}
+
+Progress_stream::~Progress_stream()
+{
+  stop_ = true;
+  monitor_.join();
+  std::signal(SIGUSR1, SIG_DFL);
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+}
+
+auto Progress_stream::begin_render(Renderer& renderer, std::size_t frame,
+                                   std::string dump_filename) -> void
+{
+  {
+    std::scoped_lock lock{mutex_};
+    rendering_ = true;
+    frame_ = frame;
+    completed_tiles_ = 0;
+    completed_pixels_ = 0;
+    total_tiles_ = renderer.tile_descs().size();
+    sample_per_pixel_ = renderer.sample_per_pixel();
+    start_ = Clock::now();
+    // Dumps miss the tiles in flight, so they have no sample count to merge
+    // by
+    partial_ = Image(renderer.width(), renderer.height());
+    dump_filename_ = std::move(dump_filename);
+  }
+  renderer.set_tile_callback([this](const Tile& tile) { on_tile(tile); });
+
+  write_line(fmt::format(
+      R"({{"event": "start", "frame": {}, "width": {}, "height": {}, )"
+      R"("spp": {}, "total_tiles": {}}})",
+      frame, renderer.width(), renderer.height(), renderer.sample_per_pixel(),
+      total_tiles_));
+}
+
+auto Progress_stream::end_render() -> void
+{
+  write_progress("done");
+  std::scoped_lock lock{mutex_};
+  rendering_ = false;
+}
+
+auto Progress_stream::on_tile(const Tile& tile) -> void
+{
+  {
+    std::scoped_lock lock{mutex_};
+    write_tile(tile, partial_);
+    ++completed_tiles_;
+    completed_pixels_ += tile.width() * tile.height();
+  }
+  write_progress("tile");
+}
+
+auto Progress_stream::write_progress(const char* event) -> void
+{
+  std::string line;
+  {
+    std::scoped_lock lock{mutex_};
+    const std::chrono::duration<double> elapsed = Clock::now() - start_;
+    const double seconds = elapsed.count();
+    const double samples =
+        static_cast<double>(completed_pixels_ * sample_per_pixel_);
+    const double samples_per_second = seconds > 0 ? samples / seconds : 0;
+    const double remaining_tiles =
+        static_cast<double>(total_tiles_ - completed_tiles_);
+    // Unknown until the first tile is done
+    const auto eta =
+        completed_tiles_ == 0
+            ? std::string{"null"}
+            : fmt::format("{:.3f}", seconds * remaining_tiles /
+                                        static_cast<double>(completed_tiles_));
+    line = fmt::format(
+        R"({{"event": "{}", "frame": {}, "completed_tiles": {}, )"
+        R"("total_tiles": {}, "elapsed_seconds": {:.3f}, )"
+        R"("samples_per_second": {:.1f}, "eta_seconds": {}, )"
+        R"("rss_bytes": {}}})",
+        event, frame_, completed_tiles_, total_tiles_, seconds,
+        samples_per_second, eta, resident_memory());
+  }
+  write_line(line);
+}
+
+auto Progress_stream::write_line(const std::string& line) -> void
+{
+  std::scoped_lock lock{write_mutex_};
+  if (is_closed_) {
+    return;
+  }
+
+  const auto data = line + '\n';
+  std::size_t written = 0;
+  while (written < data.size()) {
+    const auto result = ::write(fd_, data.data() + written,
+                                data.size() - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // The reader is gone, keep rendering without reporting. The descriptor
+      // stays open until the monitor thread, which polls it, is stopped.
+      fmt::print(stderr, "Warning: progress stream closed: {}\n",
+                 std::strerror(errno));
+      is_closed_ = true;
+      return;
+    }
+    written += static_cast<std::size_t>(result);
+  }
+}
+
+auto Progress_stream::dump_partial_image() -> void
+{
+  std::optional<Image> image;
+  std::string filename;
+  {
+    std::scoped_lock lock{mutex_};
+    if (!rendering_) {
+      return;
+    }
+    image = partial_;
+    filename = dump_filename_;
+  }
+
+  try {
+    image->saveto(filename);
+    const nlohmann::json event = {{"event", "dump"}, {"filename", filename}};
+    write_line(event.dump());
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "Warning: cannot dump the partial image: {}\n",
+               e.what());
+  }
+}
+
+// Returns whether a dump was requested through the socket
+auto Progress_stream::poll_commands() -> bool
+{
+  if (!is_socket_) {
+    return false;
+  }
+
+  // fd_ is only closed by the destructor, after the monitor thread stopped
+  pollfd poll_fd{fd_, POLLIN, 0};
+  if (::poll(&poll_fd, 1, 0) <= 0 || (poll_fd.revents & POLLIN) == 0) {
+    return false;
+  }
+  std::array<char, 256> buffer{};
+  const auto size = ::recv(fd_, buffer.data(), buffer.size(), MSG_DONTWAIT);
+  if (size <= 0) {
+    return false;
+  }
+  return std::string_view{buffer.data(), static_cast<std::size_t>(size)}
+             .find("dump") != std::string_view::npos;
+}
+
+auto Progress_stream::monitor() -> void
+{
+  auto last_heartbeat = Clock::now();
+  while (!stop_) {
+    std::this_thread::sleep_for(poll_interval);
+
+    if (dump_requested.exchange(false) || poll_commands()) {
+      dump_partial_image();
+    }
+
+    bool rendering = false;
+    {
+      std::scoped_lock lock{mutex_};
+      rendering = rendering_;
+    }
+    if (rendering && Clock::now() - last_heartbeat >= heartbeat_interval) {
+      write_progress("heartbeat");
+      last_heartbeat = Clock::now();
+    }
+  }
+}
+
+} // namespace lesty
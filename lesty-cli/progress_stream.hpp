@@ -0,0 +1,95 @@
+#ifndef LESTY_CLI_PROGRESS_STREAM_HPP
+#define LESTY_CLI_PROGRESS_STREAM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "image.hpp"
+#include "renderer.hpp"
+
+/**
+ * @file progress_stream.hpp
+ * @brief Machine readable progress of renders for job schedulers
+ *
+ * Every line written to the stream is a JSON object with an "event" field:
+ * - "start" when a frame starts
+ * - "tile" whenever a tile is done
+ * - "heartbeat" every few seconds, so that stuck jobs can be spotted
+ * - "dump" when the partial image is written
+ * - "done" when a frame is done
+ *
+ * Progress events report the completed tiles, the samples per second, the
+ * estimated remaining time and the resident memory of the process.
+ *
+ * The partially rendered image is written on SIGUSR1, or when a line "dump"
+ * is received on a Unix socket stream.
+ */
+
+namespace lesty {
+
+class Progress_stream {
+public:
+  /**
+   * @brief Opens a progress stream
+   * @param target "fd:N" to write to an already opened file descriptor, or
+   * "unix:PATH" to connect to a listening Unix socket
+   * @throw std::runtime_error if the target is invalid or cannot be connected
+   */
+  explicit Progress_stream(const std::string& target);
+  ~Progress_stream();
+
+  Progress_stream(const Progress_stream&) = delete;
+  auto operator=(const Progress_stream&) -> Progress_stream& = delete;
+
+  /**
+   * @brief Starts reporting a render of renderer
+   * @param dump_filename Where the partial image of this render is written
+   *
+   * Installs the tile callback of the renderer, which needs to outlive the
+   * render.
+   */
+  auto begin_render(Renderer& renderer, std::size_t frame,
+                    std::string dump_filename) -> void;
+
+  auto end_render() -> void;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  auto on_tile(const Tile& tile) -> void;
+  auto write_progress(const char* event) -> void;
+  auto write_line(const std::string& line) -> void;
+  auto dump_partial_image() -> void;
+  auto poll_commands() -> bool;
+  auto monitor() -> void;
+
+  // Set by the constructor and only closed by the destructor
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  bool is_socket_ = false;
+  std::mutex write_mutex_;
+  bool is_closed_ = false; ///< The reader is gone, guarded by write_mutex_
+
+  // State of the current render, guarded by mutex_
+  std::mutex mutex_;
+  bool rendering_ = false;
+  std::size_t frame_ = 0;
+  std::size_t completed_tiles_ = 0;
+  std::size_t total_tiles_ = 0;
+  std::size_t completed_pixels_ = 0;
+  std::size_t sample_per_pixel_ = 0;
+  Clock::time_point start_;
+  Image partial_{0, 0};
+  std::string dump_filename_;
+
+  std::atomic<bool> stop_ = false;
+  std::thread monitor_;
+};
+
+} // namespace lesty
+
+#endif // LESTY_CLI_PROGRESS_STREAM_HPP
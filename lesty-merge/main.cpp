@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4702)
+#endif
+
+#include <cxxopts.hpp>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <fmt/format.h>
+
+#include "image.hpp"
+
+using namespace lesty;
+
+struct Merge_options {
+  std::vector<std::string> input_filenames;
+  std::string output_filename;
+};
+
+[[nodiscard]] auto parse_cmd(int argc, char** argv) -> Merge_options
+{
+  cxxopts::Options options(
+      "lesty-merge",
+      "Merges raw images of disjoint sample ranges rendered by lesty");
+
+  options.positional_help("FILE...").show_positional_help();
+
+  // clang-format off
+  options.add_options()
+      ("h,help", "Print help")
+      ("o,output", "File name of the merged image (png, pfm, exr or raw)", cxxopts::value<std::string>()->default_value("merged.png"))
+      ("inputs", "Raw images to merge", cxxopts::value<std::vector<std::string>>());
+  // clang-format on
+
+  options.parse_positional({"inputs"});
+
+  auto result = [&]() {
+    try {
+      return options.parse(argc, argv);
+    } catch (cxxopts::OptionParseException& e) {
+      fmt::print(stderr, "Error: {}\n", e.what());
+      std::exit(-1);
+    }
+  }();
+
+  if (result.count("help")) {
+    std::puts(options.help({""}).c_str());
+    exit(0);
+  }
+
+  if (!result.count("inputs")) {
+    std::fputs("Error: Need at least one raw image to merge\n\n", stderr);
+    std::exit(-1);
+  }
+
+  return Merge_options{result["inputs"].as<std::vector<std::string>>(),
+                       result["output"].as<std::string>()};
+}
+
+int main(int argc, char** argv)
+try {
+  const auto options = parse_cmd(argc, argv);
+
+  std::vector<Image> images;
+  images.reserve(options.input_filenames.size());
+  for (const auto& filename : options.input_filenames) {
+    images.push_back(Image::load_raw(filename));
+    fmt::print("{}: {}x{}, {} samples\n", filename, images.back().width(),
+               images.back().height(), images.back().sample_count());
+  }
+
+  const auto merged = merge_sample_ranges(images);
+  merged.saveto(options.output_filename);
+  fmt::print("Save {} samples per pixel to {}\n", merged.sample_count(),
+             options.output_filename);
+  return 0;
+} catch (const std::exception& e) {
+  fmt::print(stderr, "Error: {}\n", e.what());
+  return 1;
+}
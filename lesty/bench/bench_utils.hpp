@@ -0,0 +1,76 @@
+#ifndef LESTY_BENCH_UTILS_HPP
+#define LESTY_BENCH_UTILS_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "arena.hpp"
+#include "hitable.hpp"
+#include "ray.hpp"
+#include "rng.hpp"
+#include "triangle.hpp"
+
+namespace lesty::bench {
+
+// Every benchmark uses the same seed so that the inputs are identical between
+// runs
+constexpr std::uint64_t seed = 42;
+
+[[nodiscard]] inline auto random_vector(Rng& rng, float extent)
+    -> beyond::Vec3
+{
+  return beyond::Vec3{(rng.uniform_float() * 2 - 1) * extent,
+                      (rng.uniform_float() * 2 - 1) * extent,
+                      (rng.uniform_float() * 2 - 1) * extent};
+}
+
+[[nodiscard]] inline auto random_point(Rng& rng, float extent)
+    -> beyond::Point3
+{
+  return beyond::Point3{0, 0, 0} + random_vector(rng, extent);
+}
+
+/**
+ * @brief Rays from random points around the origin to random points inside
+ * the cube [-extent, extent]^3
+ */
+[[nodiscard]] inline auto random_rays(std::size_t count, float extent)
+    -> std::vector<Ray>
+{
+  Rng rng{seed};
+  std::vector<Ray> rays;
+  rays.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto origin = random_point(rng, extent * 2);
+    const auto target = random_point(rng, extent);
+    rays.emplace_back(origin, normalize(target - origin));
+  }
+  return rays;
+}
+
+/**
+ * @brief Small triangles scattered uniformly inside a cube, whose volume grows
+ * with the count so that the density stays the same
+ */
+[[nodiscard]] inline auto random_triangles(Arena& arena, std::size_t count,
+                                           std::uint32_t material)
+    -> std::vector<Arena_ptr<Hitable>>
+{
+  Rng rng{seed};
+  const float extent = std::cbrt(static_cast<float>(count));
+  std::vector<Arena_ptr<Hitable>> triangles;
+  triangles.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto center = random_point(rng, extent);
+    triangles.push_back(arena.make<Triangle>(
+        center + random_vector(rng, 0.5f), center + random_vector(rng, 0.5f),
+        center + random_vector(rng, 0.5f), material));
+  }
+  return triangles;
+}
+
+} // namespace lesty::bench
+
+#endif // LESTY_BENCH_UTILS_HPP
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+#include "bounding_volume_hierarchy.hpp"
+
+namespace {
+
+using namespace lesty;
+
+constexpr std::size_t ray_count = 4096;
+constexpr float inf = std::numeric_limits<float>::infinity();
+
+constexpr std::uint32_t material = 0;
+
+// Scenes from 1k to 10M primitives
+auto scene_sizes(benchmark::internal::Benchmark* benchmark) -> void
+{
+  for (std::int64_t count = 1'000; count <= 10'000'000; count *= 10) {
+    benchmark->Arg(count);
+  }
+}
+
+void BM_BVH_build(benchmark::State& state)
+{
+  const auto count = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    Arena arena{count * sizeof(Triangle)};
+    auto triangles = bench::random_triangles(arena, count, material);
+    state.ResumeTiming();
+
+    BVH bvh{std::move(triangles)};
+    benchmark::DoNotOptimize(bvh.nodes().data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BVH_build)
+    ->Apply(scene_sizes)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_BVH_traversal(benchmark::State& state)
+{
+  const auto count = static_cast<std::size_t>(state.range(0));
+  Arena arena{count * sizeof(Triangle)};
+  const BVH bvh{bench::random_triangles(arena, count, material)};
+  const auto rays =
+      bench::random_rays(ray_count, std::cbrt(static_cast<float>(count)));
+
+  for (auto _ : state) {
+    for (const auto& ray : rays) {
+      HitRecord record;
+      benchmark::DoNotOptimize(bvh.intersection_with(ray, 0, inf, record));
+      benchmark::DoNotOptimize(record);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(rays.size()));
+}
+BENCHMARK(BM_BVH_traversal)->Apply(scene_sizes)->Unit(benchmark::kMicrosecond);
+
+} // anonymous namespace
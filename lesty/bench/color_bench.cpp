@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "color.hpp"
+
+namespace {
+
+using namespace lesty;
+
+constexpr std::size_t color_count = 4096;
+
+[[nodiscard]] auto random_colors(Rng& rng) -> std::vector<Color>
+{
+  std::vector<Color> colors(color_count);
+  for (auto& color : colors) {
+    color = Color{rng.uniform_float(), rng.uniform_float(),
+                  rng.uniform_float()};
+  }
+  return colors;
+}
+
+// Adds a sample to every pixel of a tile, then averages them
+void BM_Color_accumulate(benchmark::State& state)
+{
+  Rng rng{bench::seed};
+  const auto samples = random_colors(rng);
+  std::vector<Color> pixels(color_count);
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < color_count; ++i) {
+      pixels[i] += samples[i];
+    }
+    for (auto& pixel : pixels) {
+      pixel /= 2;
+    }
+    benchmark::DoNotOptimize(pixels.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(color_count));
+}
+BENCHMARK(BM_Color_accumulate);
+
+// The emitted + weight * incoming step of every bounce of a path
+void BM_Color_throughput(benchmark::State& state)
+{
+  Rng rng{bench::seed};
+  const auto emission = random_colors(rng);
+  const auto weights = random_colors(rng);
+  for (auto _ : state) {
+    Color radiance{};
+    for (std::size_t i = color_count; i-- > 0;) {
+      radiance = emission[i] + weights[i] * radiance;
+    }
+    benchmark::DoNotOptimize(radiance);
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(color_count));
+}
+BENCHMARK(BM_Color_throughput);
+
+// Clamps colors to [0, 1] as before the conversion to 8 bits
+void BM_Color_clamp(benchmark::State& state)
+{
+  Rng rng{bench::seed};
+  auto colors = random_colors(rng);
+  for (auto& color : colors) {
+    color *= 2;
+  }
+  for (auto _ : state) {
+    auto clamped = colors;
+    for (auto& color : clamped) {
+      color.clamp();
+    }
+    benchmark::DoNotOptimize(clamped.data());
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(color_count));
+}
+BENCHMARK(BM_Color_clamp);
+
+} // anonymous namespace
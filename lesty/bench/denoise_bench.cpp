@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+#include "denoise.hpp"
+
+namespace {
+
+using namespace lesty;
+
+// A noisy image with two regions of different normals and albedos
+void BM_Denoise(benchmark::State& state)
+{
+  const auto size = static_cast<std::size_t>(state.range(0));
+  Rng rng{bench::seed};
+  Image color{size, size};
+  Image albedo{size, size};
+  Image normals{size, size};
+  for (std::size_t y = 0; y < size; ++y) {
+    for (std::size_t x = 0; x < size; ++x) {
+      const bool left = x < size / 2;
+      color.color_at(x, y) = Color{rng.uniform_float(), rng.uniform_float(),
+                                   rng.uniform_float()};
+      albedo.color_at(x, y) = left ? Color{0.8f, 0.2f, 0.2f}
+                                   : Color{0.5f, 0.5f, 0.5f};
+      normals.color_at(x, y) = left ? Color{1, 0, 0} : Color{0, 0, 1};
+    }
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(denoise(color, albedo, normals));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(size * size));
+}
+BENCHMARK(BM_Denoise)->Arg(128)->Arg(512)->Unit(benchmark::kMillisecond);
+
+} // anonymous namespace
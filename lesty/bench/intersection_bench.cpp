@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+
+#include "aabb.hpp"
+#include "axis_aligned_rect.hpp"
+#include "bench_utils.hpp"
+#include "sphere.hpp"
+#include "triangle.hpp"
+
+namespace {
+
+using namespace lesty;
+
+constexpr std::size_t ray_count = 1024;
+constexpr float inf = std::numeric_limits<float>::infinity();
+
+constexpr std::uint32_t material = 0;
+
+// Intersects a batch of random rays with one shape per iteration
+template <typename Intersect>
+auto intersect_rays(benchmark::State& state, Intersect intersect) -> void
+{
+  const auto rays = bench::random_rays(ray_count, 1);
+  for (auto _ : state) {
+    for (const auto& ray : rays) {
+      benchmark::DoNotOptimize(intersect(ray));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(rays.size()));
+}
+
+void BM_AABB_hit(benchmark::State& state)
+{
+  const AABB box{{-0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, 0.5f}};
+  intersect_rays(state, [&box](const Ray& ray) {
+    return box.hit(ray, 0, inf);
+  });
+}
+BENCHMARK(BM_AABB_hit);
+
+void BM_Sphere_intersection(benchmark::State& state)
+{
+  const Sphere sphere{{0, 0, 0}, 0.5f, material};
+  intersect_rays(state, [&sphere](const Ray& ray) {
+    HitRecord record;
+    return sphere.intersection_with(ray, 0, inf, record) ? record.t : -1.f;
+  });
+}
+BENCHMARK(BM_Sphere_intersection);
+
+void BM_Triangle_intersection(benchmark::State& state)
+{
+  const Triangle triangle{{-0.5f, -0.5f, 0}, {0.5f, -0.5f, 0}, {0, 0.5f, 0},
+                          material};
+  intersect_rays(state, [&triangle](const Ray& ray) {
+    HitRecord record;
+    return triangle.intersection_with(ray, 0, inf, record) ? record.t : -1.f;
+  });
+}
+BENCHMARK(BM_Triangle_intersection);
+
+void BM_Rect_intersection(benchmark::State& state)
+{
+  const Rect_XY rect{{-0.5f, -0.5f}, {0.5f, 0.5f}, 0, material};
+  intersect_rays(state, [&rect](const Ray& ray) {
+    HitRecord record;
+    return rect.intersection_with(ray, 0, inf, record) ? record.t : -1.f;
+  });
+}
+BENCHMARK(BM_Rect_intersection);
+
+} // anonymous namespace
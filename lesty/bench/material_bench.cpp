@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+#include "hitable.hpp"
+#include "material.hpp"
+
+namespace {
+
+using namespace lesty;
+
+constexpr std::size_t ray_count = 1024;
+
+// Scatters a batch of rays that hit the plane z = 0 from above
+void BM_Sample_bsdf(benchmark::State& state, const Material& material)
+{
+  const auto rays = bench::random_rays(ray_count, 1);
+  Rng rng{bench::seed};
+  for (auto _ : state) {
+    for (const auto& ray : rays) {
+      const HitRecord record{1, {0, 0, 0}, {0, 0, 1}, 0, 0};
+      benchmark::DoNotOptimize(sample_bsdf(material, ray, record, rng));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(rays.size()));
+}
+
+constexpr auto lambertian = Material::lambertian(Color{0.5f, 0.5f, 0.5f});
+constexpr auto metal = Material::metal(Color{0.5f, 0.5f, 0.5f}, 0.2f);
+constexpr auto dielectric = Material::dielectric(Color{1, 1, 1}, 1.5f);
+
+BENCHMARK_CAPTURE(BM_Sample_bsdf, lambertian, lambertian);
+BENCHMARK_CAPTURE(BM_Sample_bsdf, metal, metal);
+BENCHMARK_CAPTURE(BM_Sample_bsdf, dielectric, dielectric);
+
+} // anonymous namespace
@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <fstream>
+
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "scene_parser.hpp"
+
+namespace {
+
+using namespace lesty;
+
+void BM_Render_cornell(benchmark::State& state)
+{
+  std::ifstream file{LESTY_SCENES_DIR "/cornell.json"};
+  if (!file.is_open()) {
+    state.SkipWithError("Cannot open " LESTY_SCENES_DIR "/cornell.json");
+    return;
+  }
+  const auto scene = parse_scene(file, LESTY_SCENES_DIR);
+
+  Options options{};
+  options.width = 200;
+  options.height = 150;
+  options.spp = static_cast<std::size_t>(state.range(0));
+  options.seed = 42;
+  const auto renderer =
+      create_renderers(Renderer::Type::path, options, scene.camera());
+
+  for (auto _ : state) {
+    const auto image = renderer->render(scene);
+    benchmark::DoNotOptimize(image.data().data());
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(options.width *
+                                                    options.height *
+                                                    options.spp));
+}
+BENCHMARK(BM_Render_cornell)
+    ->Arg(4)
+    ->Arg(16)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // anonymous namespace
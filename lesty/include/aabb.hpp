@@ -58,6 +58,16 @@ public:
     return max_;
   }
 
+  /**
+   * @brief Gets the surface area of the box
+   */
+  [[nodiscard]] constexpr auto surface_area() const noexcept -> float
+  {
+    const auto extent = max_ - min_;
+    return 2 * (extent.x * extent.y + extent.y * extent.z +
+                extent.z * extent.x);
+  }
+
   /**
    * @brief Whether the ray r hit AABB or not
    */
@@ -68,7 +78,7 @@ public:
     // Credit: Andrew Kensler at Pixar adapt this version of AABB hit method
     // Shirley, Peter. Ray Tracing: the Next Week
     for (std::size_t a = 0; a < num_dim; ++a) {
-      const float invD = 1.f / r.direction[a];
+      const float invD = r.inv_direction[a];
       float t0 = (min_[a] - r.origin[a]) * invD;
       float t1 = (max_[a] - r.origin[a]) * invD;
       if (invD < 0) {
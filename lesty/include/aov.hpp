@@ -0,0 +1,190 @@
+#ifndef LESTY_AOV_HPP
+#define LESTY_AOV_HPP
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "color.hpp"
+#include "image.hpp"
+
+/**
+ * @file aov.hpp
+ * @brief Arbitrary output variables, which are per pixel properties of the
+ * first hits that are recorded in the same pass as the image
+ */
+
+namespace lesty {
+
+enum class Aov : std::uint8_t {
+  depth,        ///< Distance from the camera, infinity for misses
+  normal,       ///< Unit normal, xyz in three channels, 0 for misses
+  albedo,       ///< Color of the surface, clamped to [0, 1], 0 for misses
+  primitive_id, ///< Index in Scene::objects(), -1 for misses
+  material_id   ///< Index of the material, -1 for misses
+};
+
+constexpr std::size_t aov_count = 5;
+
+constexpr std::array<Aov, aov_count> all_aovs = {
+    Aov::depth, Aov::normal, Aov::albedo, Aov::primitive_id,
+    Aov::material_id};
+
+/**
+ * @brief Number of float channels of an AOV
+ */
+[[nodiscard]] constexpr auto channel_count(Aov aov) noexcept -> std::size_t
+{
+  return aov == Aov::normal || aov == Aov::albedo ? 3 : 1;
+}
+
+[[nodiscard]] auto aov_name(Aov aov) noexcept -> std::string_view;
+
+[[nodiscard]] auto parse_aov(std::string_view name) -> std::optional<Aov>;
+
+/**
+ * @brief A set of AOVs
+ */
+class Aov_set {
+public:
+  constexpr Aov_set() noexcept = default;
+
+  constexpr Aov_set(std::initializer_list<Aov> aovs) noexcept
+  {
+    for (const auto aov : aovs) {
+      insert(aov);
+    }
+  }
+
+  [[nodiscard]] constexpr auto contains(Aov aov) const noexcept -> bool
+  {
+    return (bits_ & bit(aov)) != 0;
+  }
+
+  constexpr auto insert(Aov aov) noexcept -> void
+  {
+    bits_ |= bit(aov);
+  }
+
+  constexpr auto insert(Aov_set aovs) noexcept -> void
+  {
+    bits_ |= aovs.bits_;
+  }
+
+  [[nodiscard]] constexpr auto empty() const noexcept -> bool
+  {
+    return bits_ == 0;
+  }
+
+  [[nodiscard]] constexpr auto operator==(const Aov_set&) const noexcept
+      -> bool = default;
+
+private:
+  [[nodiscard]] static constexpr auto bit(Aov aov) noexcept -> std::uint8_t
+  {
+    return static_cast<std::uint8_t>(1u << static_cast<unsigned>(aov));
+  }
+
+  std::uint8_t bits_ = 0;
+};
+
+/**
+ * @brief The AOVs of an image or a tile, in planar float buffers
+ *
+ * Every channel of every AOV in the set has its own plane of width * height
+ * floats, row by row with the same layout as Image. Nothing is allocated for
+ * the AOVs that are not in the set.
+ */
+class Aov_buffers {
+public:
+  Aov_buffers() = default;
+
+  /**
+   * @brief Allocates the planes of aovs, initialized to the values of misses
+   */
+  Aov_buffers(Aov_set aovs, std::size_t width, std::size_t height);
+
+  [[nodiscard]] auto aovs() const noexcept -> Aov_set
+  {
+    return aovs_;
+  }
+
+  [[nodiscard]] auto empty() const noexcept -> bool
+  {
+    return aovs_.empty();
+  }
+
+  [[nodiscard]] auto width() const noexcept -> std::size_t
+  {
+    return width_;
+  }
+
+  [[nodiscard]] auto height() const noexcept -> std::size_t
+  {
+    return height_;
+  }
+
+  /**
+   * @brief Gets the plane of a channel of an AOV
+   * @pre aovs().contains(aov) && channel < channel_count(aov)
+   */
+  [[nodiscard]] auto plane(Aov aov, std::size_t channel) noexcept
+      -> std::span<float>
+  {
+    return std::span{data_}.subspan(plane_offset(aov, channel),
+                                     width_ * height_);
+  }
+
+  [[nodiscard]] auto plane(Aov aov, std::size_t channel) const noexcept
+      -> std::span<const float>
+  {
+    return std::span{data_}.subspan(plane_offset(aov, channel),
+                                     width_ * height_);
+  }
+
+  [[nodiscard]] auto at(Aov aov, std::size_t channel, std::size_t x,
+                        std::size_t y) noexcept -> float&
+  {
+    assert(x < width_ && y < height_);
+    return data_[plane_offset(aov, channel) + y * width_ + x];
+  }
+
+  [[nodiscard]] auto at(Aov aov, std::size_t channel, std::size_t x,
+                        std::size_t y) const noexcept -> float
+  {
+    assert(x < width_ && y < height_);
+    return data_[plane_offset(aov, channel) + y * width_ + x];
+  }
+
+  /**
+   * @brief Converts an AOV to an image, single channel AOVs are stored in all
+   * three channels
+   * @pre aovs().contains(aov)
+   */
+  [[nodiscard]] auto to_image(Aov aov) const -> Image;
+
+private:
+  [[nodiscard]] auto plane_offset(Aov aov, std::size_t channel) const noexcept
+      -> std::size_t
+  {
+    assert(aovs_.contains(aov) && channel < channel_count(aov));
+    return first_planes_[static_cast<std::size_t>(aov)] +
+           channel * width_ * height_;
+  }
+
+  Aov_set aovs_;
+  std::size_t width_ = 0;
+  std::size_t height_ = 0;
+  std::array<std::size_t, aov_count> first_planes_{};
+  std::vector<float> data_;
+};
+
+} // namespace lesty
+
+#endif // LESTY_AOV_HPP
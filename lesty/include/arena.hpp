@@ -0,0 +1,85 @@
+#ifndef LESTY_ARENA_HPP
+#define LESTY_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+namespace lesty {
+
+/**
+ * @brief Deleter of objects that live in an Arena
+ *
+ * Only runs the destructor, the memory is released with the whole arena.
+ */
+struct Arena_deleter {
+  template <typename T> auto operator()(T* object) const noexcept -> void
+  {
+    std::destroy_at(object);
+  }
+};
+
+/**
+ * @brief Owning pointer to an object allocated in an Arena
+ *
+ * Like std::unique_ptr, a pointer to a derived class converts to a pointer to
+ * its base class, which then needs a virtual destructor.
+ *
+ * @warning The pointer must not outlive its arena
+ */
+template <typename T> using Arena_ptr = std::unique_ptr<T, Arena_deleter>;
+
+/**
+ * @brief A monotonic memory arena for data that is built once and freed
+ * together, such as the primitives and materials of a scene
+ *
+ * Allocations are bumps of a pointer into large blocks, so objects allocated
+ * after each other are contiguous in memory. Nothing is freed before the arena
+ * is destroyed.
+ *
+ * @warning Not thread safe
+ */
+class Arena {
+public:
+  static constexpr std::size_t default_block_size = 64 * 1024;
+
+  /**
+   * @param initial_size Size of the first block, following blocks grow
+   * geometrically
+   */
+  explicit Arena(std::size_t initial_size = default_block_size)
+      : resource_{initial_size}
+  {
+  }
+
+  Arena(const Arena&) = delete;
+  auto operator=(const Arena&) -> Arena& = delete;
+
+  /**
+   * @brief Constructs an object of type T in the arena
+   */
+  template <typename T, typename... Args>
+  [[nodiscard]] auto make(Args&&... args) -> Arena_ptr<T>
+  {
+    void* memory = resource_.allocate(sizeof(T), alignof(T));
+    return Arena_ptr<T>{::new (memory) T(std::forward<Args>(args)...)};
+  }
+
+  /**
+   * @brief Gets the memory resource of the arena, for example to allocate
+   * std::pmr containers in it
+   */
+  [[nodiscard]] auto resource() noexcept -> std::pmr::memory_resource*
+  {
+    return &resource_;
+  }
+
+private:
+  std::pmr::monotonic_buffer_resource resource_;
+};
+
+} // namespace lesty
+
+#endif // LESTY_ARENA_HPP
@@ -1,10 +1,11 @@
 #ifndef LESTY_AXIS_ALIGNED_RECT_HPP
 #define LESTY_AXIS_ALIGNED_RECT_HPP
 
+#include <cstdint>
+
 #include <beyond/core/math/vector.hpp>
 
 #include "hitable.hpp"
-#include "material.hpp"
 
 namespace lesty {
 
@@ -17,8 +18,10 @@ struct Rect_XY : Hitable {
   NormalDirection direction;
 
   Rect_XY(beyond::Point2 in_min, beyond::Point2 in_max, float in_z,
-          const Material& mat, NormalDirection dir = NormalDirection::Positive)
-      : min{in_min}, max{in_max}, z{in_z}, direction{dir}, material{&mat}
+          std::uint32_t material,
+          NormalDirection dir = NormalDirection::Positive)
+      : min{in_min}, max{in_max}, z{in_z}, direction{dir},
+        material_index{material}
   {
   }
 
@@ -27,10 +30,10 @@ struct Rect_XY : Hitable {
     return AABB{{min, z - 0.0001f}, {max, z + 0.0001f}};
   }
 
-  [[nodiscard]] Maybe_hit_t intersection_with(const Ray& r, float t_min,
-                                              float t_max) const override;
+  [[nodiscard]] bool intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const override;
 
-  const Material* const material;
+  std::uint32_t material_index;
 };
 
 struct Rect_XZ : Hitable {
@@ -38,11 +41,13 @@ struct Rect_XZ : Hitable {
   beyond::Point2 max;
   float y;
   NormalDirection direction;
-  const Material* const material;
+  std::uint32_t material_index;
 
   Rect_XZ(beyond::Point2 in_min, beyond::Point2 in_max, float in_y,
-          const Material& mat, NormalDirection dir = NormalDirection::Positive)
-      : min{in_min}, max{in_max}, y{in_y}, direction{dir}, material{&mat}
+          std::uint32_t material,
+          NormalDirection dir = NormalDirection::Positive)
+      : min{in_min}, max{in_max}, y{in_y}, direction{dir},
+        material_index{material}
   {
   }
 
@@ -51,8 +56,8 @@ struct Rect_XZ : Hitable {
     return AABB{{min.x, y - 0.0001f, min.y}, {max.x, y + 0.0001f, max.y}};
   }
 
-  [[nodiscard]] Maybe_hit_t intersection_with(const Ray& r, float t_min,
-                                              float t_max) const override;
+  [[nodiscard]] bool intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const override;
 };
 
 struct Rect_YZ : Hitable {
@@ -60,11 +65,13 @@ struct Rect_YZ : Hitable {
   beyond::Point2 max;
   float x;
   NormalDirection direction;
-  const Material* const material;
+  std::uint32_t material_index;
 
   Rect_YZ(beyond::Point2 in_min, beyond::Point2 in_max, float in_x,
-          const Material& mat, NormalDirection dir = NormalDirection::Positive)
-      : min{in_min}, max{in_max}, x{in_x}, direction{dir}, material{&mat}
+          std::uint32_t material,
+          NormalDirection dir = NormalDirection::Positive)
+      : min{in_min}, max{in_max}, x{in_x}, direction{dir},
+        material_index{material}
   {
   }
 
@@ -73,8 +80,8 @@ struct Rect_YZ : Hitable {
     return AABB{{x - 0.0001f, min.x, min.y}, {x + 0.0001f, max.x, max.y}};
   }
 
-  [[nodiscard]] Maybe_hit_t intersection_with(const Ray& r, float t_min,
-                                              float t_max) const override;
+  [[nodiscard]] bool intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const override;
 };
 
 } // namespace lesty
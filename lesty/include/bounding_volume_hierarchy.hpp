@@ -1,33 +1,133 @@
 #ifndef LESTY_BOUNDING_VOLUME_HIERARCHY_HPP
 #define LESTY_BOUNDING_VOLUME_HIERARCHY_HPP
 
-#include <memory>
+#include <cstdint>
+#include <memory_resource>
 #include <vector>
 
 #include "aabb.hpp"
+#include "arena.hpp"
 #include "hitable.hpp"
+#include "rng.hpp"
 
 namespace lesty {
 
-using ObjectIterator = std::vector<std::unique_ptr<Hitable>>::iterator;
+/**
+ * @brief A node of the flattened bounding volume hierarchy
+ *
+ * Nodes are stored in depth-first order: the left child of an interior node
+ * immediately follows its parent, and every child comes after its parent.
+ */
+struct BVH_node {
+  AABB box;
 
-class BVH_node : public Hitable {
+  /// Index of the first primitive for a leaf, or the index of the right child
+  /// for an interior node
+  std::uint32_t offset = 0;
+
+  /// Number of primitives in a leaf, 0 for interior nodes
+  std::uint16_t primitive_count = 0;
+
+  /// The axis that the primitives were sorted along when splitting this node
+  std::uint8_t axis = 0;
+
+  [[nodiscard]] constexpr auto is_leaf() const noexcept -> bool
+  {
+    return primitive_count != 0;
+  }
+};
+
+/**
+ * @brief Bounding volume hierarchy that owns all the primitives of a scene
+ */
+class BVH : public Hitable {
 public:
-  BVH_node(const ObjectIterator& begin, const ObjectIterator& end) noexcept;
+  BVH() noexcept = default;
+
+  /**
+   * @param objects The primitives, usually allocated in an Arena
+   * @param resource Where the nodes and the primitive list are allocated
+   */
+  explicit BVH(std::vector<Arena_ptr<Hitable>>&& objects,
+               std::pmr::memory_resource* resource =
+                   std::pmr::get_default_resource());
 
   [[nodiscard]] auto bounding_box() const noexcept -> AABB override
   {
-    return box_;
+    return nodes_.empty() ? AABB{} : nodes_.front().box;
+  }
+
+  /**
+   * @brief Finds the closest intersection with the primitives
+   *
+   * On a hit, record.primitive_index is the index of the primitive in
+   * objects().
+   */
+  [[nodiscard]] auto intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const noexcept
+      -> bool override;
+
+  /**
+   * @brief Rebuilds the whole hierarchy from the current primitive bounds
+   */
+  auto rebuild() -> void;
+
+  /**
+   * @brief Recomputes the bounds of every node bottom-up while keeping the
+   * topology of the tree
+   *
+   * This is a single O(n) pass over the flattened nodes. The quality of the
+   * tree degrades if the primitives move a lot, see sah_cost().
+   */
+  auto refit() noexcept -> void;
+
+  /**
+   * @brief Estimates the cost of tracing a ray through the hierarchy by the
+   * surface area heuristic
+   *
+   * The cost is relative to the total surface area of the primitive bounds, so
+   * it stays comparable while the primitives move.
+   */
+  [[nodiscard]] auto sah_cost() const noexcept -> float;
+
+  /**
+   * @brief Gets the primitives in the order that they are referenced by the
+   * leaves
+   *
+   * Use object() to modify them.
+   */
+  [[nodiscard]] auto objects() const noexcept
+      -> const std::pmr::vector<Arena_ptr<Hitable>>&
+  {
+    return objects_;
+  }
+
+  [[nodiscard]] auto object(std::size_t index) const noexcept
+      -> const Hitable&
+  {
+    return *objects_[index];
   }
 
-  [[nodiscard]] auto intersection_with(const Ray& r, float t_min,
-                                       float t_max) const noexcept
-      -> std::optional<HitRecord> override;
+  /**
+   * @brief Gets a primitive to modify it, refit() or rebuild() need to be
+   * called afterward
+   */
+  [[nodiscard]] auto object(std::size_t index) noexcept -> Hitable&
+  {
+    return *objects_[index];
+  }
+
+  [[nodiscard]] auto nodes() const noexcept
+      -> const std::pmr::vector<BVH_node>&
+  {
+    return nodes_;
+  }
 
 private:
-  std::unique_ptr<const Hitable> left_ = nullptr;
-  std::unique_ptr<const Hitable> right_ = nullptr;
-  AABB box_;
+  auto build(std::size_t begin, std::size_t end, Rng& rng) -> void;
+
+  std::pmr::vector<Arena_ptr<Hitable>> objects_;
+  std::pmr::vector<BVH_node> nodes_;
 };
 
 } // namespace lesty
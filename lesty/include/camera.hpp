@@ -1,6 +1,9 @@
 #ifndef LESTY_CAMERA_HPP
 #define LESTY_CAMERA_HPP
 
+#include <cmath>
+#include <span>
+
 #include "ray.hpp"
 #include <beyond/core/math/angle.hpp>
 #include <beyond/core/math/vector.hpp>
@@ -13,12 +16,28 @@ namespace lesty {
  */
 struct Camera_sample {
   beyond::Point2 film_pos;
+  beyond::Point2 lens_pos{0.5f, 0.5f}; ///< Position on the lens in [0, 1)^2
+  float time = 0; ///< Position in the shutter interval in [0, 1)
+};
+
+/**
+ * @brief Parameters of a camera that do not depend on the output resolution
+ */
+struct Camera_settings {
+  beyond::Point3 position{};
+  beyond::Point3 lookat{0, 0, 1};
+  beyond::Vec3 up{0, 1, 0};
+  float fov = 40;           ///< Vertical field of view in degrees
+  float aperture = 0;       ///< Diameter of the lens, 0 for a pinhole camera
+  float focus_distance = 1; ///< Distance from the lens to the plane in focus
+  float shutter_open = 0;   ///< Time when the shutter opens
+  float shutter_close = 0;  ///< Time when the shutter closes
 };
 
 class Camera {
 public:
   /**
-   * @brief Constructor of a camera
+   * @brief Constructor of a pinhole camera with an instant shutter
    * @param position The position of the camera
    * @param lookat
    * @param up Direction of up
@@ -29,35 +48,120 @@ public:
          const beyond::Vec3& up, const beyond::Radian& fov,
          float aspect) noexcept
   {
-    const float half_height = std::tan(fov.value() / 2);
-    const float half_width = aspect * half_height;
-
-    origin_ = position;
-    const auto w = normalize(position - lookat);
-    const auto u = normalize(cross(up, w));
-    const auto v = cross(w, u);
+    init(position, lookat, up, fov, aspect, 1);
+  }
 
-    lower_left_corner_ = origin_ - half_width * u - half_height * v - w;
-    horizontal_ = 2 * half_width * u;
-    vertical_ = 2 * half_height * v;
+  /**
+   * @brief Constructor of a thin lens camera
+   * @param settings Parameters of the camera
+   * @param aspect Aspect ratio of the screen
+   */
+  Camera(const Camera_settings& settings, float aspect) noexcept
+      : lens_radius_{settings.aperture / 2},
+        shutter_open_{settings.shutter_open},
+        shutter_duration_{settings.shutter_close - settings.shutter_open}
+  {
+    init(settings.position, settings.lookat, settings.up,
+         beyond::Degree{settings.fov}, aspect, settings.focus_distance);
   }
 
   /**
    * @brief Generate a ray by uv coodinate
+   *
+   * The direction of the ray is normalized.
    */
   [[nodiscard]] auto get_ray(Camera_sample sample) const noexcept -> Ray
   {
     const float u = sample.film_pos.x;
     const float v = sample.film_pos.y;
-    return Ray{origin_,
-               lower_left_corner_ + u * horizontal_ + v * vertical_ - origin_};
+    const auto target = lower_left_corner_ + u * horizontal_ + v * vertical_;
+    const float time = shutter_open_ + sample.time * shutter_duration_;
+    if (lens_radius_ <= 0) {
+      return Ray{origin_, normalize(target - origin_), time};
+    }
+
+    // Uniformly samples a point on the lens disk
+    constexpr float two_pi = 6.28318530718f;
+    const float r = lens_radius_ * std::sqrt(sample.lens_pos.x);
+    const float theta = two_pi * sample.lens_pos.y;
+    const auto origin = origin_ + r * std::cos(theta) * u_ +
+                        r * std::sin(theta) * v_;
+    return Ray{origin, normalize(target - origin), time};
+  }
+
+  /**
+   * @brief Generate a batch of rays, for example a row of a tile
+   * @pre rays.size() >= samples.size()
+   */
+  auto get_rays(std::span<const Camera_sample> samples,
+                std::span<Ray> rays) const noexcept -> void
+  {
+    assert(rays.size() >= samples.size());
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+      rays[i] = get_ray(samples[i]);
+    }
+  }
+
+  /**
+   * @brief Angle between the rays through two neighbouring pixels, for an
+   * image of certain height
+   *
+   * Approximates the spread of the ray cone of a pixel, which gives the
+   * footprint of texture lookups.
+   */
+  [[nodiscard]] auto pixel_spread_angle(std::size_t image_height) const
+      noexcept -> float
+  {
+    return 2 * half_height_ / static_cast<float>(image_height);
+  }
+
+  /**
+   * @brief Whether get_ray uses the lens position of the samples
+   */
+  [[nodiscard]] auto has_lens() const noexcept -> bool
+  {
+    return lens_radius_ > 0;
+  }
+
+  /**
+   * @brief Whether get_ray uses the time of the samples
+   */
+  [[nodiscard]] auto has_motion_blur() const noexcept -> bool
+  {
+    return shutter_duration_ > 0;
   }
 
 private:
+  void init(const beyond::Point3& position, const beyond::Point3& lookat,
+            const beyond::Vec3& up, const beyond::Radian& fov, float aspect,
+            float focus_distance) noexcept
+  {
+    const float half_height = std::tan(fov.value() / 2);
+    const float half_width = aspect * half_height;
+    half_height_ = half_height;
+
+    origin_ = position;
+    const auto w = normalize(position - lookat);
+    u_ = normalize(cross(up, w));
+    v_ = cross(w, u_);
+
+    lower_left_corner_ = origin_ - half_width * focus_distance * u_ -
+                         half_height * focus_distance * v_ -
+                         focus_distance * w;
+    horizontal_ = 2 * half_width * focus_distance * u_;
+    vertical_ = 2 * half_height * focus_distance * v_;
+  }
+
   beyond::Point3 origin_{};
   beyond::Point3 lower_left_corner_{};
   beyond::Vec3 horizontal_{};
   beyond::Vec3 vertical_{};
+  beyond::Vec3 u_{};
+  beyond::Vec3 v_{};
+  float half_height_ = 0; ///< Tangent of the half vertical field of view
+  float lens_radius_ = 0;
+  float shutter_open_ = 0;
+  float shutter_duration_ = 0;
 };
 
 } // namespace lesty
@@ -0,0 +1,120 @@
+#ifndef LESTY_CAMERA_PATH_HPP
+#define LESTY_CAMERA_PATH_HPP
+
+#include <cassert>
+#include <vector>
+
+#include "camera.hpp"
+
+namespace lesty {
+
+/**
+ * @brief The state of a camera at a certain time of an animation
+ */
+struct Camera_keyframe {
+  float time = 0;
+  Camera_settings settings{};
+};
+
+/**
+ * @brief A camera animation that is sampled into a fixed number of frames
+ *
+ * Keyframes are linearly interpolated, and the frames are evenly distributed
+ * between the first and the last keyframe.
+ */
+class Camera_path {
+public:
+  /**
+   * @brief Constructs a camera path
+   * @param keyframes Keyframes sorted by time, need to have at least one
+   * element
+   * @param frame_count How many frames to render along the path
+   */
+  Camera_path(std::vector<Camera_keyframe> keyframes,
+              std::size_t frame_count) noexcept
+      : keyframes_{std::move(keyframes)}, frame_count_{frame_count}
+  {
+    assert(!keyframes_.empty());
+  }
+
+  [[nodiscard]] auto frame_count() const noexcept -> std::size_t
+  {
+    return frame_count_;
+  }
+
+  [[nodiscard]] auto keyframes() const noexcept
+      -> const std::vector<Camera_keyframe>&
+  {
+    return keyframes_;
+  }
+
+  /**
+   * @brief Interpolates the keyframes at time t
+   *
+   * Times outside of the path are clamped to the first or the last keyframe.
+   */
+  [[nodiscard]] auto keyframe_at(float t) const noexcept -> Camera_keyframe
+  {
+    if (t <= keyframes_.front().time) {
+      return keyframes_.front();
+    }
+
+    for (std::size_t i = 1; i < keyframes_.size(); ++i) {
+      const auto& next = keyframes_[i];
+      if (t < next.time) {
+        const auto& prev = keyframes_[i - 1];
+        const float s = (t - prev.time) / (next.time - prev.time);
+        return Camera_keyframe{t,
+                               interpolate(prev.settings, next.settings, s)};
+      }
+    }
+    return keyframes_.back();
+  }
+
+  /**
+   * @brief Gets the time of the frame-th frame of the path
+   */
+  [[nodiscard]] auto frame_time(std::size_t frame) const noexcept -> float
+  {
+    const float begin = keyframes_.front().time;
+    const float end = keyframes_.back().time;
+    if (frame_count_ <= 1) {
+      return begin;
+    }
+    return begin + (end - begin) * static_cast<float>(frame) /
+                       static_cast<float>(frame_count_ - 1);
+  }
+
+  /**
+   * @brief Creates the camera for the frame-th frame of the path
+   */
+  [[nodiscard]] auto camera_at_frame(std::size_t frame, float aspect) const
+      noexcept -> Camera
+  {
+    return Camera{keyframe_at(frame_time(frame)).settings, aspect};
+  }
+
+private:
+  [[nodiscard]] static auto interpolate(const Camera_settings& lhs,
+                                        const Camera_settings& rhs,
+                                        float s) noexcept -> Camera_settings
+  {
+    const auto lerp = [s](float a, float b) { return a + s * (b - a); };
+    return Camera_settings{
+        lhs.position + s * (rhs.position - lhs.position),
+        lhs.lookat + s * (rhs.lookat - lhs.lookat),
+        lhs.up + s * (rhs.up - lhs.up),
+        lerp(lhs.fov, rhs.fov),
+        lerp(lhs.aperture, rhs.aperture),
+        lerp(lhs.focus_distance, rhs.focus_distance),
+        lerp(lhs.shutter_open, rhs.shutter_open),
+        lerp(lhs.shutter_close, rhs.shutter_close)};
+  }
+
+  std::vector<Camera_keyframe> keyframes_;
+  std::size_t frame_count_ = 1;
+};
+
+} // namespace lesty
+
+#endif // LESTY_CAMERA_PATH_HPP
@@ -2,13 +2,26 @@
 #define LESTY_COLOR_HPP
 
 #include <algorithm>
+#include <bit>
+#include <ostream>
+#include <type_traits>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) ||               \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LESTY_COLOR_SSE
+#include <xmmintrin.h>
+#endif
 
 namespace lesty {
 
 /**
- * \brief 24 bit float RGB color
+ * \brief Float RGB color, padded to four channels
+ *
+ * The padding lets the operators work on all channels with one SSE
+ * instruction at runtime. In constant expressions, they fall back to scalar
+ * code.
  */
-struct Color {
+struct alignas(16) Color {
   /// Red component of the color.
   float r = 0;
 
@@ -18,13 +31,17 @@ struct Color {
   /// Blue component of the color.
   float b = 0;
 
+  /// Pads the color to four channels. Operators keep it at 0, so that it
+  /// never turns into NaN or denormals.
+  float padding = 0;
+
   /**
-   * \brief Constructs a new black 24 bit RGB Color.
+   * \brief Constructs a new black RGB Color.
    */
   constexpr Color() noexcept = default;
 
   /**
-   * \brief Constructs a new 24 bit float RGB Color with given r,g,b components.
+   * \brief Constructs a new float RGB Color with given r,g,b components.
    * \param red, green, blue
    */
   constexpr Color(float red, float green, float blue) noexcept
@@ -32,45 +49,11 @@ struct Color {
   {
   }
 
-  constexpr Color& operator*=(float rhs) noexcept
-  {
-    r *= rhs;
-    g *= rhs;
-    b *= rhs;
-    return *this;
-  }
-
-  constexpr Color& operator/=(float rhs) noexcept
-  {
-    r /= rhs;
-    g /= rhs;
-    b /= rhs;
-    return *this;
-  }
-
-  constexpr Color& operator*=(const Color& rhs) noexcept
-  {
-    r *= rhs.r;
-    g *= rhs.g;
-    b *= rhs.b;
-    return *this;
-  }
-
-  constexpr Color& operator+=(const Color& rhs) noexcept
-  {
-    r += rhs.r;
-    g += rhs.g;
-    b += rhs.b;
-    return *this;
-  }
-
-  constexpr Color& operator-=(const Color& rhs) noexcept
-  {
-    r -= rhs.r;
-    g -= rhs.g;
-    b -= rhs.b;
-    return *this;
-  }
+  constexpr Color& operator*=(float rhs) noexcept;
+  constexpr Color& operator/=(float rhs) noexcept;
+  constexpr Color& operator*=(const Color& rhs) noexcept;
+  constexpr Color& operator+=(const Color& rhs) noexcept;
+  constexpr Color& operator-=(const Color& rhs) noexcept;
 
   /**
    * @brief Operator << of Color.
@@ -90,14 +73,33 @@ struct Color {
   /**
    * @brief Clamps the RGB values of color to [0, 1)
    */
-  constexpr void clamp() noexcept
-  {
-    r = std::clamp(r, 0.0f, 1.0f);
-    g = std::clamp(g, 0.0f, 1.0f);
-    b = std::clamp(b, 0.0f, 1.0f);
-  }
+  constexpr void clamp() noexcept;
 };
 
+static_assert(sizeof(Color) == 4 * sizeof(float));
+
+#ifdef LESTY_COLOR_SSE
+namespace detail {
+
+[[nodiscard]] inline auto load(const Color& color) noexcept -> __m128
+{
+  return std::bit_cast<__m128>(color);
+}
+
+[[nodiscard]] inline auto store(__m128 v) noexcept -> Color
+{
+  return std::bit_cast<Color>(v);
+}
+
+// Broadcasts a scalar to the RGB channels, and keeps the padding at 0
+[[nodiscard]] inline auto splat_rgb(float scalar) noexcept -> __m128
+{
+  return _mm_setr_ps(scalar, scalar, scalar, 0);
+}
+
+} // namespace detail
+#endif
+
 constexpr bool operator==(const Color& lhs, const Color& rhs) noexcept
 {
   return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
@@ -105,32 +107,113 @@ constexpr bool operator==(const Color& lhs, const Color& rhs) noexcept
 
 constexpr Color operator+(const Color& lhs, const Color& rhs) noexcept
 {
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    return detail::store(_mm_add_ps(detail::load(lhs), detail::load(rhs)));
+  }
+#endif
   return Color(lhs.r + rhs.r, lhs.g + rhs.g, lhs.b + rhs.b);
 }
 
 constexpr Color operator-(const Color& lhs, const Color& rhs) noexcept
 {
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    return detail::store(_mm_sub_ps(detail::load(lhs), detail::load(rhs)));
+  }
+#endif
   return Color(lhs.r - rhs.r, lhs.g - rhs.g, lhs.b - rhs.b);
 }
 
 constexpr Color operator*(const Color& lhs, const Color& rhs) noexcept
 {
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    return detail::store(_mm_mul_ps(detail::load(lhs), detail::load(rhs)));
+  }
+#endif
   return Color(lhs.r * rhs.r, lhs.g * rhs.g, lhs.b * rhs.b);
 }
 
+constexpr Color operator/(const Color& lhs, const Color& rhs) noexcept
+{
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    // Dividing the padding by 1 instead of 0 keeps it at 0
+    const auto divisor =
+        _mm_add_ps(detail::load(rhs), _mm_setr_ps(0, 0, 0, 1));
+    return detail::store(_mm_div_ps(detail::load(lhs), divisor));
+  }
+#endif
+  return Color(lhs.r / rhs.r, lhs.g / rhs.g, lhs.b / rhs.b);
+}
+
 constexpr Color operator*(const Color& c, float scalar) noexcept
 {
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    return detail::store(
+        _mm_mul_ps(detail::load(c), detail::splat_rgb(scalar)));
+  }
+#endif
   return Color(c.r * scalar, c.g * scalar, c.b * scalar);
 }
 
 constexpr Color operator/(const Color& c, float scalar) noexcept
 {
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    // Dividing the padding by 1 instead of scalar keeps it at 0
+    return detail::store(
+        _mm_div_ps(detail::load(c), _mm_setr_ps(scalar, scalar, scalar, 1)));
+  }
+#endif
   return Color(c.r / scalar, c.g / scalar, c.b / scalar);
 }
 
 constexpr Color operator*(float scalar, const Color& c) noexcept
 {
-  return Color(c.r * scalar, c.g * scalar, c.b * scalar);
+  return c * scalar;
+}
+
+constexpr Color& Color::operator*=(float rhs) noexcept
+{
+  return *this = *this * rhs;
+}
+
+constexpr Color& Color::operator/=(float rhs) noexcept
+{
+  return *this = *this / rhs;
+}
+
+constexpr Color& Color::operator*=(const Color& rhs) noexcept
+{
+  return *this = *this * rhs;
+}
+
+constexpr Color& Color::operator+=(const Color& rhs) noexcept
+{
+  return *this = *this + rhs;
+}
+
+constexpr Color& Color::operator-=(const Color& rhs) noexcept
+{
+  return *this = *this - rhs;
+}
+
+constexpr void Color::clamp() noexcept
+{
+#ifdef LESTY_COLOR_SSE
+  if (!std::is_constant_evaluated()) {
+    *this = detail::store(_mm_min_ps(
+        _mm_max_ps(detail::load(*this), _mm_setzero_ps()),
+        detail::splat_rgb(1)));
+    return;
+  }
+#endif
+  r = std::clamp(r, 0.0f, 1.0f);
+  g = std::clamp(g, 0.0f, 1.0f);
+  b = std::clamp(b, 0.0f, 1.0f);
 }
 
 } // namespace lesty
@@ -0,0 +1,47 @@
+#ifndef LESTY_DENOISE_HPP
+#define LESTY_DENOISE_HPP
+
+#include <cstddef>
+
+#include "image.hpp"
+
+namespace lesty {
+
+struct Denoise_options {
+  /// Number of passes, pass i reads pixels 2^i apart, so 5 passes cover a
+  /// 125 pixels wide footprint
+  std::size_t iterations = 5;
+
+  /// How much the illumination of two pixels can differ before they stop
+  /// being averaged, halved at every pass
+  float color_sigma = 2.f;
+
+  /// Same for the distance between the normals
+  float normal_sigma = 0.3f;
+
+  /// Same for the distance between the albedos
+  float albedo_sigma = 0.1f;
+};
+
+/**
+ * @brief Removes the noise of a render with few samples per pixel
+ *
+ * Implements the edge-avoiding à-trous wavelet filter. The render is divided
+ * by the albedo, so that textures stay sharp, and the remaining illumination
+ * is blurred with a wider kernel at every pass. Pixels are only averaged
+ * with neighbours of similar illumination, normal and albedo, which keeps
+ * the edges of objects. Rows are filtered in parallel.
+ *
+ * Credit: Dammertz et al., "Edge-Avoiding À-Trous Wavelet Transform for fast
+ * Global Illumination Filtering", HPG 2010
+ *
+ * @param albedo, normals The AOVs of the first hits of the render
+ * @throw std::invalid_argument if the images do not have the same size
+ */
+[[nodiscard]] auto denoise(const Image& color, const Image& albedo,
+                           const Image& normals,
+                           const Denoise_options& options = {}) -> Image;
+
+} // namespace lesty
+
+#endif // LESTY_DENOISE_HPP
@@ -0,0 +1,235 @@
+#ifndef LESTY_GEOMETRY_CACHE_HPP
+#define LESTY_GEOMETRY_CACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <beyond/core/math/vector.hpp>
+
+#include "aabb.hpp"
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
+#include "hitable.hpp"
+
+/**
+ * @file geometry_cache.hpp
+ * @brief Triangle meshes that are loaded from disk on demand
+ *
+ * A baked geometry file splits a mesh into spatially coherent chunks, and
+ * starts with a table of their bounds. A scene only reads the table up
+ * front, so the BVH of the scene is built over the chunk bounds, and the
+ * triangles of a chunk are loaded when a ray first reaches its bounds. Loaded
+ * chunks are evicted in least recently used order to keep within a memory
+ * budget.
+ */
+
+namespace lesty {
+
+/// Magic bytes at the beginning of baked geometry files
+constexpr char baked_geometry_magic[8] = {'L', 'E', 'S', 'T',
+                                          'Y', 'G', 'E', 'O'};
+constexpr std::uint32_t baked_geometry_version = 1;
+
+using Triangle_vertices = std::array<beyond::Point3, 3>;
+
+/**
+ * @brief Writes triangles to a baked geometry file
+ *
+ * Triangles are split at the median of their centroids along the longest
+ * axis, until every chunk has at most triangles_per_chunk triangles.
+ *
+ * @throw Cannot_write_file if the file cannot be written
+ */
+auto bake_geometry(const std::string& filename,
+                   std::span<const Triangle_vertices> triangles,
+                   std::size_t triangles_per_chunk = 4096) -> void;
+
+class Geometry_cache;
+
+/**
+ * @brief A chunk of a baked geometry file that stands for its triangles in
+ * the scene
+ *
+ * The bounds are known without loading the chunk, so a chunk can be placed
+ * in a BVH like any other primitive.
+ */
+class Geometry_chunk : public Hitable {
+public:
+  Geometry_chunk(Geometry_cache& cache, std::uint32_t file_index,
+                 const AABB& bounds, std::uint64_t offset,
+                 std::uint64_t triangle_count, std::uint32_t material)
+      : cache_{&cache}, bounds_{bounds}, offset_{offset},
+        triangle_count_{triangle_count}, file_index_{file_index},
+        material_index_{material}
+  {
+  }
+
+  [[nodiscard]] auto bounding_box() const -> AABB override
+  {
+    return bounds_;
+  }
+
+  /**
+   * @brief Intersects the triangles of the chunk, which loads them if they
+   * are not in memory
+   * @see Hitable::intersection_with
+   */
+  [[nodiscard]] auto intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const
+      -> bool override;
+
+  [[nodiscard]] auto triangle_count() const noexcept -> std::uint64_t
+  {
+    return triangle_count_;
+  }
+
+  /**
+   * @brief Whether the triangles of the chunk are currently in memory
+   */
+  [[nodiscard]] auto is_resident() const -> bool;
+
+private:
+  friend class Geometry_cache;
+
+  // The triangles and the BVH over them
+  struct Geometry;
+
+  Geometry_cache* cache_;
+  AABB bounds_;
+  std::uint64_t offset_;
+  std::uint64_t triangle_count_;
+  std::uint32_t file_index_;
+  std::uint32_t material_index_;
+
+  // Owned by the cache and only replaced under its mutex, but read without
+  // it, so that rays that reach a resident chunk do not wait for each other
+  mutable std::atomic<const Geometry*> geometry_ = nullptr;
+  // Value of the clock of the cache when the chunk was last used
+  mutable std::atomic<std::uint64_t> last_use_ = 0;
+};
+
+/**
+ * @brief Keeps the loaded chunks of baked geometry files within a memory
+ * budget
+ *
+ * Thread safe. Intersecting a resident chunk is an atomic load of its
+ * geometry, only loads and evictions take a lock. Threads read the geometry
+ * inside a Read_guard, and evicted geometry is only freed once every guard
+ * that was alive when it was evicted is gone.
+ */
+class Geometry_cache {
+public:
+  /**
+   * @brief Keeps the geometry that the thread reaches alive while it exists
+   *
+   * Chunks take a guard for every intersection if the thread holds none. A
+   * guard that spans many intersections, such as a tile, saves that cost,
+   * but holds back the memory of the chunks that are evicted meanwhile.
+   */
+  class Read_guard {
+  public:
+    /**
+     * @param cache The cache to read, nothing is guarded if it is null
+     */
+    explicit Read_guard(Geometry_cache* cache) noexcept;
+    ~Read_guard();
+
+    Read_guard(const Read_guard&) = delete;
+    auto operator=(const Read_guard&) -> Read_guard& = delete;
+
+  private:
+    // Null if the cache was already guarded by the thread
+    Geometry_cache* cache_ = nullptr;
+    const Geometry_cache* previous_ = nullptr;
+    std::uint64_t epoch_ = 0;
+  };
+
+  /**
+   * @param budget Bytes of geometry to keep in memory, 0 for no limit
+   */
+  explicit Geometry_cache(std::size_t budget = 0);
+  ~Geometry_cache();
+
+  Geometry_cache(const Geometry_cache&) = delete;
+  auto operator=(const Geometry_cache&) -> Geometry_cache& = delete;
+
+  /**
+   * @brief Reads the chunk table of a baked geometry file
+   * @param material Material index of all triangles of the file
+   * @return A chunk per entry of the table, allocated in the arena
+   * @throw Cannot_read_file if the file cannot be read or is not a baked
+   * geometry file
+   */
+  [[nodiscard]] auto open(const std::string& filename, std::uint32_t material,
+                          Arena& arena) -> std::vector<Arena_ptr<Hitable>>;
+
+  [[nodiscard]] auto budget() const -> std::size_t;
+
+  /**
+   * @brief Changes the budget, evicting chunks if needed
+   *
+   * The chunk loaded last is always kept, even if it exceeds the budget on its
+   * own.
+   */
+  auto set_budget(std::size_t budget) -> void;
+
+  /**
+   * @brief Bytes used by the chunks in memory
+   */
+  [[nodiscard]] auto memory_size() const -> std::size_t;
+
+  /**
+   * @brief Number of chunk loads so far, including the reloads of evicted
+   * chunks
+   */
+  [[nodiscard]] auto load_count() const -> std::size_t;
+
+private:
+  friend class Geometry_chunk;
+
+  using Geometry = Geometry_chunk::Geometry;
+  using Resident_chunk =
+      std::pair<const Geometry_chunk*, std::unique_ptr<const Geometry>>;
+
+  // Gets the geometry of a chunk, and loads it if needed. The geometry stays
+  // alive while the thread holds a Read_guard.
+  [[nodiscard]] auto acquire(const Geometry_chunk& chunk) -> const Geometry*;
+  [[nodiscard]] auto load(const Geometry_chunk& chunk) const
+      -> std::unique_ptr<const Geometry>;
+  auto evict_over_budget() -> void;
+  // Frees the retired geometry that no reader can reach anymore
+  auto reclaim() -> void;
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> filenames_;
+  std::size_t budget_;
+  std::size_t memory_size_ = 0;
+  std::size_t load_count_ = 0;
+
+  // Advances on every load, chunks that are used are stamped with it, so the
+  // chunks with the oldest stamps are the least recently used
+  std::atomic<std::uint64_t> clock_ = 0;
+  std::vector<Resident_chunk> resident_;
+
+  // Evicted geometry is retired with the epoch in which it was evicted. The
+  // readers count themselves in the slot of the epoch in which they started,
+  // and the epoch only advances once no reader of the previous one is left,
+  // so geometry retired before the current epoch is unreachable once the
+  // slot of the previous epoch is empty.
+  std::atomic<std::uint64_t> epoch_ = 0;
+  std::array<std::atomic<std::size_t>, 2> readers_{};
+  std::vector<std::pair<std::uint64_t, std::unique_ptr<const Geometry>>>
+      retired_;
+};
+
+} // namespace lesty
+
+#endif // LESTY_GEOMETRY_CACHE_HPP
@@ -0,0 +1,21 @@
+#ifndef LESTY_HEATMAP_HPP
+#define LESTY_HEATMAP_HPP
+
+#include "image.hpp"
+
+namespace lesty {
+
+/**
+ * @brief Maps per pixel costs to false colors, from blue for cheap pixels to
+ * red for the most expensive ones
+ *
+ * Costs are read from the red channel. They are normalized by a high
+ * percentile instead of the maximum, so that a few outliers do not make the
+ * rest of the image uniformly blue. The result should be saved with
+ * Image::Transfer::linear.
+ */
+[[nodiscard]] auto false_color_heatmap(const Image& costs) -> Image;
+
+} // namespace lesty
+
+#endif // LESTY_HEATMAP_HPP
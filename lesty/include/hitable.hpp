@@ -1,7 +1,7 @@
 #ifndef LESTY_HITABLE_HPP
 #define LESTY_HITABLE_HPP
 
-#include <optional>
+#include <cstdint>
 
 #include <beyond/core/math/vector.hpp>
 
@@ -10,20 +10,27 @@
 namespace lesty {
 
 struct Ray;
-class Material;
 
 /**
  * @brief Data recorded for a ray-object intersection
+ *
+ * Refers to the primitive and the material by their indices in the scene
+ * rather than by pointers, which keeps the record small and assignable, so
+ * that traversal can update a single record in place.
  */
 struct HitRecord {
   float t{};
   beyond::Point3 point{}; ///< Intersection point
   beyond::Vec3
       normal{}; ///< Surface normal, need to be construct as a unit vector
-  const Material* const material{};
-};
+  std::uint32_t primitive_index{}; ///< Index in Scene::objects(), set by BVH
+  std::uint32_t material_index{};  ///< Index in the materials of the scene
+  beyond::Point2 uv{}; ///< Texture coordinates of the intersection point
 
-using Maybe_hit_t = std::optional<HitRecord>;
+  /// Change of the texture coordinates per unit of distance on the surface,
+  /// which converts the footprint of a ray to texture space
+  float uv_scale{};
+};
 
 struct Hitable {
   virtual ~Hitable() = default;
@@ -37,11 +44,14 @@ struct Hitable {
 
   /**
    * @brief Ray-object intersection detection
-   * @return A optional record of intersection information, nothing if not hit
+   * @param record Overwritten with the intersection information if hit, left
+   * untouched otherwise
+   * @return true if the ray hits the object within [t_min, t_max]
    */
   [[nodiscard]] virtual auto intersection_with(const Ray& r, float t_min,
-                                               float t_max) const
-      -> std::optional<HitRecord> = 0;
+                                               float t_max,
+                                               HitRecord& record) const
+      -> bool = 0;
 };
 
 } // namespace lesty
@@ -1,6 +1,9 @@
 #ifndef LESTY_IMAGE_HPP
 #define LESTY_IMAGE_HPP
 
+#include <cstdint>
+#include <future>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -24,17 +27,75 @@ struct Cannot_write_file : public std::runtime_error {
   }
 };
 
+struct Cannot_read_file : public std::runtime_error {
+  explicit Cannot_read_file(const char* filename)
+      : std::runtime_error{filename}
+  {
+  }
+};
+
+/// Magic bytes at the beginning of raw image files
+constexpr char raw_image_magic[8] = {'L', 'E', 'S', 'T', 'Y', 'R', 'A', 'W'};
+constexpr std::uint32_t raw_image_version = 1;
+
 class Image {
 public:
+  /**
+   * @brief How linear values are tone mapped and encoded into 8-bit images
+   *
+   * Values outside of [0, 1] after tone mapping are clamped.
+   */
+  enum class Transfer {
+    gamma,    ///< Gamma corrected, for renders
+    linear,   ///< Values in [0, 1] are stored as they are, for false colors
+    srgb,     ///< The sRGB transfer function, values above 1 are clipped
+    reinhard, ///< Reinhard's x / (1 + x) per channel, then sRGB
+    aces      ///< Narkowicz's fit of the ACES filmic curve, then sRGB
+  };
+
   Image(size_t width, size_t height);
 
   /**
    * @brief Save the image into a file
    * @param filename with extension
    *
-   * Currently only support ppm as extension.
+   * Supports the following extensions:
+   * - png: gamma corrected 8-bit
+   * - pfm: portable float map of linear values
+   * - exr: uncompressed OpenEXR of linear 32-bit floats
+   * - raw: a header followed by the linear RGB floats of every pixel,
+   *   packed without the padding lane of Color, in the row order of Image
+   *
+   * @param transfer How png images encode the values, float formats always
+   * store linear values
+   *
+   * @throw Unsupported_image_extension for other extensions
+   * @throw Cannot_write_file if the file cannot be written
+   */
+  void saveto(const std::string& filename,
+              Transfer transfer = Transfer::gamma) const;
+
+  /**
+   * @brief Converts the image to 8-bit RGB, from the top row to the bottom
+   * row, as stored in png files
+   *
+   * Rows are converted in parallel.
+   */
+  [[nodiscard]] auto to_8bit(Transfer transfer = Transfer::gamma) const
+      -> std::vector<std::uint8_t>;
+
+  /**
+   * @brief Encodes the image as a png file in memory
+   * @throw Cannot_write_file if the image cannot be encoded
+   */
+  [[nodiscard]] auto to_png(Transfer transfer = Transfer::gamma) const
+      -> std::vector<std::uint8_t>;
+
+  /**
+   * @brief Loads an image saved in the raw format
+   * @throw Cannot_read_file if the file cannot be read or is not a raw image
    */
-  void saveto(const std::string& filename) const;
+  [[nodiscard]] static auto load_raw(const std::string& filename) -> Image;
 
   size_t width() const
   {
@@ -58,7 +119,37 @@ public:
     return data_[y * width_ + x];
   }
 
+  /**
+   * @brief Gets all pixels, row by row from the bottom
+   */
+  [[nodiscard]] auto data() const noexcept -> const std::vector<Color>&
+  {
+    return data_;
+  }
+
+  /**
+   * @brief Number of samples averaged into every pixel, 0 if unknown or if
+   * pixels have different numbers of samples
+   */
+  [[nodiscard]] auto sample_count() const noexcept -> std::uint64_t
+  {
+    return sample_count_;
+  }
+
+  void set_sample_count(std::uint64_t sample_count) noexcept
+  {
+    sample_count_ = sample_count;
+  }
+
 private:
+  // Gets the pixel of an output image where row 0 is the top
+  auto output_pixel(size_t row, size_t col) const noexcept -> const Color&;
+
+  void save_png(const std::string& filename, Transfer transfer) const;
+  void save_pfm(const std::string& filename) const;
+  void save_exr(const std::string& filename) const;
+  void save_raw(const std::string& filename) const;
+
   void bound_checking(size_t x, size_t y) const
   {
     if (x >= width_ || y >= height_) {
@@ -73,8 +164,39 @@ private:
   size_t width_;
   size_t height_;
   std::vector<Color> data_;
+  std::uint64_t sample_count_ = 0;
 };
 
+/**
+ * @brief Applies the tone mapping curve of a transfer to a linear color
+ * @return Display referred linear color, the encoding is not applied
+ */
+[[nodiscard]] auto tonemap(const Color& color,
+                           Image::Transfer transfer) noexcept -> Color;
+
+/**
+ * @brief Merges renders of disjoint sample ranges of the same frame
+ *
+ * Every pixel of the result is the average of the inputs weighted by their
+ * sample counts, which is the image a single render of all the samples would
+ * produce, up to floating point rounding.
+ *
+ * @throw std::invalid_argument if there is no image, if the sizes of the
+ * images differ, or if an image does not know its sample count, such as the
+ * render of a crop or a stopped render
+ */
+[[nodiscard]] auto merge_sample_ranges(std::span<const Image> images) -> Image;
+
+/**
+ * @brief Save the image into a file on a background thread
+ *
+ * The image is moved into the task, so the caller can go on rendering the
+ * next image while this one is being encoded and written.
+ */
+[[nodiscard]] auto save_async(Image image, std::string filename,
+                              Image::Transfer transfer = Image::Transfer::gamma)
+    -> std::future<void>;
+
 } // namespace lesty
 
 #endif // LESTY_IMAGE_HPP
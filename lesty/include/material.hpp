@@ -1,94 +1,103 @@
 #ifndef LESTY_MATERIAL_HPP
 #define LESTY_MATERIAL_HPP
 
-#include <optional>
-#include <variant>
+#include <cstdint>
 
-#include <beyond/core/math/angle.hpp>
+#include <beyond/core/math/vector.hpp>
 
 #include "color.hpp"
 #include "hitable.hpp"
 #include "ray.hpp"
+#include "rng.hpp"
+#include "texture.hpp"
 
 namespace lesty {
 
-class Material {
-public:
-  Material() noexcept = default;
-  explicit Material(Color albedo) noexcept : albedo_{albedo} {}
-  virtual ~Material() = default;
-
-  /**
-   * @brief scatter
-   * @param ray_in Incident ray
-   * @param record
-   * @return scattered ray if the incident ray is not absorbed
-   */
-  virtual std::optional<Ray> scatter(const Ray& ray_in,
-                                     const HitRecord& record) const = 0;
-
-  virtual Color emitted() const
-  {
-    return Color{};
-  }
+/**
+ * @brief Parameters of a material
+ *
+ * Materials are plain tagged records rather than a class hierarchy, so that a
+ * scene stores them in a compact table and shading dispatches with a switch
+ * on the type instead of virtual calls.
+ */
+struct Material {
+  enum class Type : std::uint8_t { lambertian, metal, dielectric, emission };
 
-  constexpr Color albedo() const noexcept
-  {
-    return albedo_;
-  }
+  Type type = Type::lambertian;
 
-private:
-  Color albedo_{0.5f, 0.5f, 0.5f};
-};
+  /// Albedo of the surface, or the emitted radiance for Type::emission
+  Color color{0.5f, 0.5f, 0.5f};
 
-class Lambertian : public Material {
-public:
-  explicit Lambertian(Color albedo) noexcept : Material{albedo} {}
+  /// Fuzzness for Type::metal, which is the roughness alpha of the GGX
+  /// microfacet distribution, refractive index for Type::dielectric
+  float parameter = 0;
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const HitRecord& record) const override;
-};
+  /// Index of a texture in the scene that multiplies the color, no_texture
+  /// for a uniform color
+  std::uint32_t texture = no_texture;
 
-class Metal : public Material {
-public:
-  Metal(Color albedo, float fuzzness) noexcept
-      : Material{albedo}, fuzzness_{fuzzness}
+  [[nodiscard]] static constexpr auto lambertian(Color albedo) noexcept
+      -> Material
   {
+    return Material{Type::lambertian, albedo, 0, no_texture};
   }
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const HitRecord& record) const override;
-
-private:
-  float fuzzness_;
-};
-
-class Dielectric : public Material {
-public:
-  Dielectric(Color albedo, float refractive_index) noexcept
-      : Material{albedo}, refractive_index_{refractive_index}
+  [[nodiscard]] static constexpr auto metal(Color albedo,
+                                            float fuzzness) noexcept
+      -> Material
   {
+    return Material{Type::metal, albedo, fuzzness, no_texture};
   }
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const HitRecord& record) const override;
+  [[nodiscard]] static constexpr auto dielectric(Color albedo,
+                                                 float refractive_index) noexcept
+      -> Material
+  {
+    return Material{Type::dielectric, albedo, refractive_index, no_texture};
+  }
 
-private:
-  float refractive_index_;
+  [[nodiscard]] static constexpr auto emission(Color emit) noexcept
+      -> Material
+  {
+    return Material{Type::emission, emit, 0, no_texture};
+  }
 };
 
-class Emission : public Material {
-public:
-  explicit Emission(Color emit) noexcept : emit_(emit) {}
+/**
+ * @brief A direction sampled from a BSDF
+ */
+struct Bsdf_sample {
+  beyond::Vec3 direction{}; ///< Unit direction of the scattered ray
+  Color weight{}; ///< Throughput of the sample, the BSDF * cosine / pdf
 
-  std::optional<Ray> scatter(const Ray& ray_in,
-                             const HitRecord& record) const override;
-  Color emitted() const override;
+  /// Density of the direction over solid angle. 1 for the specular lobes that
+  /// only scatter into one direction, 0 if the ray is absorbed.
+  float pdf = 0;
 
-private:
-  Color emit_;
+  [[nodiscard]] constexpr auto is_absorbed() const noexcept -> bool
+  {
+    return pdf == 0;
+  }
 };
 
+/**
+ * @brief Samples the direction of a ray that scatters from a surface
+ * @param ray_in Incident ray, its direction need to be a unit vector
+ * @param rng Source of the random numbers of the sample being traced
+ */
+[[nodiscard]] auto sample_bsdf(const Material& material, const Ray& ray_in,
+                               const HitRecord& record, Rng& rng) noexcept
+    -> Bsdf_sample;
+
+/**
+ * @brief Gets the radiance emitted by a surface
+ */
+[[nodiscard]] constexpr auto emitted(const Material& material) noexcept
+    -> Color
+{
+  return material.type == Material::Type::emission ? material.color : Color{};
+}
+
 } // namespace lesty
 
 #endif // LESTY_MATERIAL_HPP
@@ -2,6 +2,7 @@
 #define LESTY_RAY_HPP
 
 #include <cassert>
+#include <limits>
 
 #include <beyond/core/math/vector.hpp>
 
@@ -11,11 +12,19 @@ namespace lesty {
  * @brief Represent a function of ray F(t)=A+Bt where x and y are two vectors
  * that represent origin and direction
  *
- * @warning Ray do not garentee that its direction is a unit vector
+ * Rays generated by the camera and scattered by materials have unit
+ * directions, so the rest of the renderer does not need to normalize them
+ * again. Ray itself does not enforce that.
+ *
+ * The reciprocal of the direction is precomputed at construction, so the
+ * direction should not be modified afterward.
  */
 struct Ray {
   beyond::Point3 origin = {0, 0, 0};
   beyond::Vec3 direction = {1, 0, 0};
+  beyond::Vec3 inv_direction = {1, std::numeric_limits<float>::infinity(),
+                                std::numeric_limits<float>::infinity()};
+  float time = 0; ///< The moment when the ray is cast, for motion blur
 
   /**
    * @brief Default construct a ray with origin at <0,0,0> and facing 0
@@ -27,8 +36,10 @@ struct Ray {
    * @brief Construct a ray by its origin and direction
    * @related Ray
    */
-  constexpr Ray(beyond::Point3 a, beyond::Vec3 b)
-      : origin{std::move(a)}, direction{std::move(b)}
+  constexpr Ray(beyond::Point3 a, beyond::Vec3 b, float t = 0)
+      : origin{std::move(a)}, direction{std::move(b)},
+        inv_direction{1 / direction.x, 1 / direction.y, 1 / direction.z},
+        time{t}
   {
   }
 
@@ -3,21 +3,52 @@
 #ifndef LESTY_RENDERER_HPP
 #define LESTY_RENDERER_HPP
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <span>
+#include <stop_token>
+#include <vector>
 
+#include "aov.hpp"
 #include "camera.hpp"
 #include "image.hpp"
 #include "tile.hpp"
 
 namespace lesty {
 
+/// Order in which the tiles of an image are rendered
+enum class Tile_order {
+  scanline, ///< Row by row from the bottom
+  center    ///< Closest to the center of the rendered region first
+};
+
 struct Options {
   std::size_t spp;
+  std::size_t first_sample = 0; ///< Index of the first sample to render
+  std::uint64_t seed = 0;       ///< Seed of all random numbers of the render
   std::size_t width;
   std::size_t height;
   std::string input_filename;
   std::string output_filename;
+  std::string stats_filename; ///< Empty to not report performance counters
+  std::string trace_filename; ///< Empty to not record a trace
+  std::string heatmap_filename; ///< Empty to not record per pixel costs
+  std::string camera_path_filename; ///< Empty to use the path of the scene
+  std::size_t frame_count = 0; ///< 0 to use the frame count of the path
+  std::string listen_address;  ///< Coordinator address of distributed renders
+  std::string connect_address; ///< Address to connect as a worker
+  std::size_t spawn_workers = 0; ///< Local workers to spawn as a coordinator
+  std::string progress_target; ///< Empty to not stream progress events
+  std::string progress_dump_filename; ///< Where partial images are dumped
+  std::size_t texture_memory = 0; ///< Texture budget in bytes, 0 for no limit
+  std::size_t geometry_memory = 0; ///< Budget of baked geometry in bytes
+  Image::Transfer tonemap = Image::Transfer::gamma; ///< Of 8-bit outputs
+  Aov_set aovs; ///< AOVs to write next to the output image
+  bool denoise = false; ///< Filters the image guided by the first hits
+  int preview_fd = -1; ///< Where preview frames go, -1 to render in batch
+  TileDesc crop{}; ///< Region to render, an empty region for the whole image
+  Tile_order tile_order = Tile_order::scanline;
 };
 
 class Scene;
@@ -29,23 +60,85 @@ class Renderer {
   size_t width_ = 0;
   size_t height_ = 0;
   size_t sample_per_pixel_ = 0;
+  size_t first_sample_ = 0;
+  std::uint64_t seed_ = 0;
+  bool record_costs_ = false;
+  Aov_set aovs_;
+  TileDesc crop_{};
+  Tile_order tile_order_ = Tile_order::scanline;
+  std::stop_token stop_;
   Camera camera_;
+  Image costs_{0, 0};
+  Aov_buffers aov_buffers_;
 
   std::function<void(double progress)> set_progress_;
+  std::function<void(const Tile& tile)> tile_finished_;
 
 public:
   enum class Type { path };
 
   Renderer(size_t width, size_t height, size_t sample_per_pixel, Camera camera)
-      : width_{width}, height_{height},
-        sample_per_pixel_{sample_per_pixel}, camera_{std::move(camera)}
+      : width_{width}, height_{height}, sample_per_pixel_{sample_per_pixel},
+        crop_{0, 0, width, height}, camera_{std::move(camera)}
   {
   }
 
   virtual ~Renderer() = default;
 
-  /// @brief Render the scene to an image
-  [[nodiscard]] auto render(const Scene& scene) -> Image;
+  /**
+   * @brief Render the scene to an image
+   *
+   * Tiles are rendered by one thread per core in the order of tile_descs().
+   * Once stop is requested, the tiles that have not started are skipped and
+   * the tiles in flight stop after their current sample, so the render
+   * returns soon with a partial image.
+   *
+   * The sample count of the image is the one of common_sample_count().
+   */
+  [[nodiscard]] auto render(const Scene& scene, std::stop_token stop = {})
+      -> Image;
+
+  /**
+   * @brief Gets the number of samples of every pixel of an image made of the
+   * tiles
+   *
+   * Images are merged by their sample counts, so it is 0 unless every pixel
+   * has the same number of samples: when the render is cropped, or tiles
+   * were stopped after different numbers of samples.
+   */
+  [[nodiscard]] auto common_sample_count(std::span<const Tile> tiles) const
+      noexcept -> size_t;
+
+  /**
+   * @brief Whether the crop region is the whole image
+   */
+  [[nodiscard]] auto renders_whole_image() const noexcept -> bool;
+
+  /**
+   * @brief Splits the cropped region of the image into the tiles that render()
+   * renders, in the order of tile_order()
+   */
+  [[nodiscard]] auto tile_descs() const -> std::vector<TileDesc>;
+
+  /**
+   * @brief Whether stop was requested for the render in progress
+   *
+   * render_tile() checks it between samples.
+   */
+  [[nodiscard]] auto stop_requested() const noexcept -> bool
+  {
+    return stop_.stop_requested();
+  }
+
+  /**
+   * @brief Render a single tile of the image
+   *
+   * The result of a tile only depends on the scene, the settings of the
+   * renderer and its seed, so tiles can be rendered in any order, by any
+   * thread or process.
+   */
+  virtual auto render_tile(const TileDesc& tile_desc, const Scene& scene)
+      -> Tile = 0;
 
   /**
    * @brief Sets a callback function that gets invoked when the integrator make
@@ -67,6 +160,24 @@ public:
     }
   }
 
+  /**
+   * @brief Sets a callback function that gets invoked with every tile as soon
+   * as it is rendered, before the whole image is done
+   *
+   * @warning The function func must be thread safe
+   */
+  template <class Func> auto set_tile_callback(Func&& tile_finished) -> void
+  {
+    tile_finished_ = std::forward<Func>(tile_finished);
+  }
+
+  auto finish_tile(const Tile& tile) -> void
+  {
+    if (tile_finished_) {
+      tile_finished_(tile);
+    }
+  }
+
   [[nodiscard]] auto width() const -> size_t
   {
     return width_;
@@ -79,17 +190,148 @@ public:
   {
     return sample_per_pixel_;
   }
+  /**
+   * @brief Index of the first sample of every pixel that the renderer renders
+   *
+   * A renderer renders the samples [first_sample, first_sample + spp) of each
+   * pixel. Renders of disjoint sample ranges can be merged with
+   * merge_sample_ranges.
+   */
+  [[nodiscard]] auto first_sample() const -> size_t
+  {
+    return first_sample_;
+  }
+
+  auto set_first_sample(size_t first_sample) -> void
+  {
+    first_sample_ = first_sample;
+  }
+
+  /**
+   * @brief Whether render() records the time spent on every pixel
+   *
+   * Measuring the time adds some overhead, so it is meant for debugging slow
+   * scenes.
+   */
+  [[nodiscard]] auto record_costs() const -> bool
+  {
+    return record_costs_;
+  }
+
+  auto set_record_costs(bool record_costs) -> void
+  {
+    record_costs_ = record_costs;
+  }
+
+  /**
+   * @brief Gets the seconds spent on every pixel by the last render()
+   *
+   * The cost is stored in all three channels. The image is empty if costs
+   * were not recorded.
+   */
+  [[nodiscard]] auto costs() const -> const Image&
+  {
+    return costs_;
+  }
+
+  /**
+   * @brief The AOVs that render() records from the first hit of every pixel
+   *
+   * The normal and the albedo are averaged over the samples of a pixel. The
+   * depth and the ids cannot be averaged, so they come from the first sample.
+   * No AOV is recorded by default, which costs nothing.
+   */
+  [[nodiscard]] auto aovs() const -> Aov_set
+  {
+    return aovs_;
+  }
+
+  auto set_aovs(Aov_set aovs) -> void
+  {
+    aovs_ = aovs;
+  }
+
+  /**
+   * @brief Gets the AOVs recorded by the last render()
+   */
+  [[nodiscard]] auto aov_buffers() const -> const Aov_buffers&
+  {
+    return aov_buffers_;
+  }
+
+  /**
+   * @brief Region of the image that render() renders, the whole image by
+   * default
+   *
+   * The region uses the coordinates of Image::color_at. Pixels outside of it
+   * stay black, and pixels inside it are the same as in a render of the
+   * whole image.
+   */
+  [[nodiscard]] auto crop() const -> const TileDesc&
+  {
+    return crop_;
+  }
+
+  /**
+   * @throw std::invalid_argument if the region is empty or not inside the
+   * image
+   */
+  auto set_crop(const TileDesc& crop) -> void;
+
+  [[nodiscard]] auto tile_order() const -> Tile_order
+  {
+    return tile_order_;
+  }
+
+  auto set_tile_order(Tile_order tile_order) -> void
+  {
+    tile_order_ = tile_order;
+  }
+
+  [[nodiscard]] auto seed() const -> std::uint64_t
+  {
+    return seed_;
+  }
+
+  auto set_seed(std::uint64_t seed) -> void
+  {
+    seed_ = seed;
+  }
+
   [[nodiscard]] auto camera() const -> const Camera&
   {
     return camera_;
   }
 
-private:
-  virtual auto render_tile(const TileDesc& tile_desc, const Scene& scene)
-      -> Tile = 0;
+  /**
+   * @brief Replaces the camera for the following renders
+   * @warning Should not be called while rendering
+   */
+  auto set_camera(Camera camera) -> void
+  {
+    camera_ = std::move(camera);
+  }
 };
 
-[[nodiscard]] auto create_renderers(Renderer::Type type, const Options& options)
+/**
+ * @brief Copies the pixels of a tile into the image
+ */
+auto write_tile(const Tile& tile, Image& image) -> void;
+
+/**
+ * @brief Copies the per pixel costs of a tile into the image
+ * @pre tile.has_costs()
+ */
+auto write_tile_costs(const Tile& tile, Image& image) -> void;
+
+/**
+ * @brief Copies the AOVs of a tile into the buffers of the whole image
+ * @pre tile.aovs().aovs() == buffers.aovs()
+ */
+auto write_tile_aovs(const Tile& tile, Aov_buffers& buffers) -> void;
+
+[[nodiscard]] auto create_renderers(Renderer::Type type, const Options& options,
+                                    const Camera_settings& camera)
     -> std::unique_ptr<Renderer>;
 
 } // namespace lesty
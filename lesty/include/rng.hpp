@@ -0,0 +1,92 @@
+#ifndef LESTY_RNG_HPP
+#define LESTY_RNG_HPP
+
+#include <cstdint>
+#include <limits>
+
+namespace lesty {
+
+/**
+ * @brief Mixes a value into a seed, so that nearby inputs give unrelated seeds
+ *
+ * Credit: the finalizer of SplitMix64 by Sebastiano Vigna
+ */
+[[nodiscard]] constexpr auto mix_seed(std::uint64_t seed,
+                                      std::uint64_t value) noexcept
+    -> std::uint64_t
+{
+  std::uint64_t z = seed + 0x9e3779b97f4a7c15ull * (value + 1);
+  z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31u);
+}
+
+/**
+ * @brief A small and fast seedable random number generator
+ *
+ * This is the PCG32 generator by Melissa O'Neill. It satisfies the
+ * UniformRandomBitGenerator requirements, so it works with the distributions
+ * of <random>.
+ */
+class Rng {
+public:
+  using result_type = std::uint32_t;
+
+  constexpr Rng() noexcept : Rng{0} {}
+
+  /**
+   * @brief Creates a generator from a seed
+   * @param seed The starting state
+   * @param stream Generators with different streams produce independent
+   * sequences even with the same seed
+   */
+  explicit constexpr Rng(std::uint64_t seed, std::uint64_t stream = 0) noexcept
+      : increment_{(stream << 1u) | 1u}
+  {
+    next();
+    state_ += seed;
+    next();
+  }
+
+  [[nodiscard]] static constexpr auto min() noexcept -> result_type
+  {
+    return 0;
+  }
+
+  [[nodiscard]] static constexpr auto max() noexcept -> result_type
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr auto operator()() noexcept -> result_type
+  {
+    return next();
+  }
+
+  /**
+   * @brief Generates a uniformly distributed float in [0, 1)
+   */
+  constexpr auto uniform_float() noexcept -> float
+  {
+    // The upper 24 bits fit exactly into the mantissa of a float
+    return static_cast<float>(next() >> 8u) * 0x1p-24f;
+  }
+
+private:
+  constexpr auto next() noexcept -> result_type
+  {
+    const auto old_state = state_;
+    state_ = old_state * 6364136223846793005ull + increment_;
+    const auto xor_shifted =
+        static_cast<std::uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+    const auto rotation = static_cast<std::uint32_t>(old_state >> 59u);
+    return (xor_shifted >> rotation) | (xor_shifted << ((-rotation) & 31u));
+  }
+
+  std::uint64_t state_ = 0;
+  std::uint64_t increment_ = 1;
+};
+
+} // namespace lesty
+
+#endif // LESTY_RNG_HPP
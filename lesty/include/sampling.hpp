@@ -0,0 +1,142 @@
+#ifndef LESTY_SAMPLING_HPP
+#define LESTY_SAMPLING_HPP
+
+#include <algorithm>
+#include <cmath>
+
+#include <beyond/core/math/vector.hpp>
+
+/**
+ * @file sampling.hpp
+ * @brief Building blocks of BSDF sampling
+ *
+ * Directions in the local shading frame have the surface normal as +z.
+ */
+
+namespace lesty {
+
+inline constexpr float pi = 3.14159265359f;
+inline constexpr float inv_pi = 0.318309886184f;
+
+/**
+ * @brief An orthonormal basis around a unit normal
+ */
+struct Onb {
+  beyond::Vec3 tangent;
+  beyond::Vec3 bitangent;
+  beyond::Vec3 normal;
+
+  /**
+   * @brief Builds a basis around a unit vector n without branches
+   *
+   * Credit: Duff et al., "Building an Orthonormal Basis, Revisited", JCGT 2017
+   */
+  [[nodiscard]] static auto from_normal(beyond::Vec3 n) noexcept -> Onb
+  {
+    const float sign = std::copysign(1.f, n.z);
+    const float a = -1 / (sign + n.z);
+    const float b = n.x * n.y * a;
+    return Onb{{1 + sign * n.x * n.x * a, sign * b, -sign * n.x},
+               {b, sign + n.y * n.y * a, -n.y},
+               n};
+  }
+
+  [[nodiscard]] auto to_world(beyond::Vec3 v) const noexcept -> beyond::Vec3
+  {
+    return v.x * tangent + v.y * bitangent + v.z * normal;
+  }
+
+  [[nodiscard]] auto to_local(beyond::Vec3 v) const noexcept -> beyond::Vec3
+  {
+    return {dot(v, tangent), dot(v, bitangent), dot(v, normal)};
+  }
+};
+
+/**
+ * @brief Maps two uniform numbers in [0, 1) to a direction of the upper
+ * hemisphere, with a density proportional to its cosine
+ * @see cosine_hemisphere_pdf
+ */
+[[nodiscard]] inline auto sample_cosine_hemisphere(float u1, float u2) noexcept
+    -> beyond::Vec3
+{
+  // Malley's method: project a uniform sample of the disk to the hemisphere
+  const float r = std::sqrt(u1);
+  const float phi = 2 * pi * u2;
+  return {r * std::cos(phi), r * std::sin(phi), std::sqrt(1 - u1)};
+}
+
+[[nodiscard]] constexpr auto cosine_hemisphere_pdf(float cos_theta) noexcept
+    -> float
+{
+  return cos_theta * inv_pi;
+}
+
+/**
+ * @brief Normal distribution function of GGX (Trowbridge-Reitz)
+ * @param h The microfacet normal in the local frame
+ * @param alpha Roughness, 0 for a perfect mirror
+ */
+[[nodiscard]] constexpr auto ggx_distribution(beyond::Vec3 h,
+                                              float alpha) noexcept -> float
+{
+  const float alpha2 = alpha * alpha;
+  const float d = h.z * h.z * (alpha2 - 1) + 1;
+  return alpha2 / (pi * d * d);
+}
+
+/**
+ * @brief Smith masking function of GGX for the direction v in the local frame
+ */
+[[nodiscard]] inline auto ggx_smith_g1(beyond::Vec3 v, float alpha) noexcept
+    -> float
+{
+  const float cos_theta = std::abs(v.z);
+  const float alpha2 = alpha * alpha;
+  return 2 * cos_theta /
+         (cos_theta +
+          std::sqrt(alpha2 + (1 - alpha2) * cos_theta * cos_theta));
+}
+
+/**
+ * @brief Samples a microfacet normal of GGX that is visible from wo
+ *
+ * The density of the result is G1(wo) * max(0, dot(wo, h)) * D(h) / wo.z.
+ * Sampling only visible normals wastes no samples on back facing microfacets.
+ *
+ * Credit: Heitz, "Sampling the GGX Distribution of Visible Normals", JCGT 2018
+ *
+ * @param wo The outgoing direction in the local frame, with a positive z
+ */
+[[nodiscard]] inline auto sample_ggx_visible_normal(beyond::Vec3 wo,
+                                                    float alpha, float u1,
+                                                    float u2) noexcept
+    -> beyond::Vec3
+{
+  // Transforms the view direction to the hemisphere configuration
+  const auto vh = normalize(beyond::Vec3{alpha * wo.x, alpha * wo.y, wo.z});
+
+  const float length2 = vh.x * vh.x + vh.y * vh.y;
+  const auto t1 = length2 > 0
+                      ? beyond::Vec3{-vh.y, vh.x, 0} / std::sqrt(length2)
+                      : beyond::Vec3{1, 0, 0};
+  const auto t2 = cross(vh, t1);
+
+  // Samples the projected area of the visible hemisphere
+  const float r = std::sqrt(u1);
+  const float phi = 2 * pi * u2;
+  const float p1 = r * std::cos(phi);
+  const float s = 0.5f * (1 + vh.z);
+  const float p2 =
+      (1 - s) * std::sqrt(std::max(0.f, 1 - p1 * p1)) + s * r * std::sin(phi);
+  const auto nh = p1 * t1 + p2 * t2 +
+                  std::sqrt(std::max(0.f, 1 - p1 * p1 - p2 * p2)) * vh;
+
+  // Transforms the normal back to the ellipsoid configuration
+  return normalize(
+      beyond::Vec3{alpha * nh.x, alpha * nh.y, std::max(0.f, nh.z)});
+}
+
+} // namespace lesty
+
+#endif // LESTY_SAMPLING_HPP
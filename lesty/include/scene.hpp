@@ -1,14 +1,23 @@
 #ifndef LESTY_SCENE_HPP
 #define LESTY_SCENE_HPP
 
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <type_traits>
 #include <vector>
 
+#include "arena.hpp"
+#include "bounding_volume_hierarchy.hpp"
 #include "camera.hpp"
+#include "camera_path.hpp"
+#include "geometry_cache.hpp"
 #include "hitable.hpp"
 #include "material.hpp"
 #include "renderer.hpp"
+#include "texture.hpp"
 
 namespace lesty {
 
@@ -19,24 +28,157 @@ class Scene {
 public:
   /**
    * @brief Constructs a Scene object
-   * @param aggregate The combination of all objects in the scene
-   * @param materials Ownership of all materials used for the scene
+   * @param arena The arena where objects are allocated, the BVH and the
+   * material table are allocated in it too
+   * @param objects All objects in the scene
+   * @param materials All materials used for the scene, objects refer to them
+   * by their indices
+   * @param textures All textures used for the scene, allocated in the arena,
+   * materials refer to them by their indices
+   * @param geometry_cache The cache of the baked geometry chunks among the
+   * objects, allocated in the arena, or nullptr
    */
-  Scene(std::unique_ptr<Hitable>&& aggregate,
-        std::vector<std::unique_ptr<Material>>&& materials) noexcept
-      : aggregate_{std::move(aggregate)}, materials_{std::move(materials)}
+  Scene(std::unique_ptr<Arena> arena,
+        std::vector<Arena_ptr<Hitable>>&& objects,
+        const std::vector<Material>& materials,
+        std::vector<Arena_ptr<Texture>>&& textures = {},
+        Arena_ptr<Geometry_cache> geometry_cache = nullptr)
+      : arena_{std::move(arena)}, geometry_cache_{std::move(geometry_cache)},
+        bvh_{std::move(objects), arena_->resource()},
+        materials_{materials.begin(), materials.end(), arena_->resource()},
+        textures_{std::make_move_iterator(textures.begin()),
+                  std::make_move_iterator(textures.end()), arena_->resource()},
+        built_sah_cost_{bvh_.sah_cost()}
   {
   }
 
   /**
-   * @brief Returns the hit record at the closet hit point
+   * @brief Finds the closest hit point of a ray
+   * @param record Overwritten with the closest hit, if there is any
+   * @return true if the ray hits the scene
    */
-  [[nodiscard]] auto intersect_at(const Ray& r) const
-      -> std::optional<HitRecord>;
+  [[nodiscard]] auto intersect_at(const Ray& r, HitRecord& record) const
+      -> bool;
+
+  /**
+   * @brief Gets a material by the index stored in the hit records
+   */
+  [[nodiscard]] auto material(std::uint32_t index) const noexcept
+      -> const Material&
+  {
+    return materials_[index];
+  }
+
+  /**
+   * @brief Gets a texture by the index stored in the materials
+   */
+  [[nodiscard]] auto texture(std::uint32_t index) const noexcept
+      -> const Texture&
+  {
+    return *textures_[index];
+  }
+
+  /**
+   * @brief Gets all textures in the scene
+   * @see fit_memory_budget
+   */
+  [[nodiscard]] auto textures() const noexcept
+      -> const std::pmr::vector<Arena_ptr<Texture>>&
+  {
+    return textures_;
+  }
+
+  /**
+   * @brief Gets all objects in the scene
+   *
+   * Use object() to modify them.
+   */
+  [[nodiscard]] auto objects() const noexcept
+      -> const std::pmr::vector<Arena_ptr<Hitable>>&
+  {
+    return bvh_.objects();
+  }
+
+  [[nodiscard]] auto object(std::size_t index) const noexcept
+      -> const Hitable&
+  {
+    return bvh_.object(index);
+  }
+
+  /**
+   * @brief Gets an object to move it between frames
+   *
+   * update_bvh() need to be called before rendering the scene again.
+   */
+  [[nodiscard]] auto object(std::size_t index) noexcept -> Hitable&
+  {
+    return bvh_.object(index);
+  }
+
+  /**
+   * @brief Gets the cache that loads baked geometry on demand
+   * @return nullptr if the scene has no baked geometry
+   */
+  [[nodiscard]] auto geometry_cache() const noexcept -> Geometry_cache*
+  {
+    return geometry_cache_.get();
+  }
+
+  [[nodiscard]] auto bvh() const noexcept -> const BVH&
+  {
+    return bvh_;
+  }
+
+  /**
+   * @brief Updates the acceleration structure after objects moved
+   *
+   * The BVH is refitted in place, and only get rebuilt from scratch when its
+   * SAH cost grows beyond rebuild_threshold times the cost of the last build.
+   * The camera paths of scene files only animate the camera, so this is for
+   * callers that move objects between the frames themselves.
+   *
+   * @return true if the BVH was rebuilt
+   */
+  auto update_bvh(float rebuild_threshold = 1.5f) -> bool;
+
+  /**
+   * @brief Gets the camera of the scene
+   */
+  [[nodiscard]] auto camera() const noexcept -> const Camera_settings&
+  {
+    return camera_;
+  }
+
+  auto set_camera(const Camera_settings& camera) -> void
+  {
+    camera_ = camera;
+  }
+
+  /**
+   * @brief Gets the camera animation of the scene, if there is any
+   */
+  [[nodiscard]] auto camera_path() const noexcept
+      -> const std::optional<Camera_path>&
+  {
+    return camera_path_;
+  }
+
+  auto set_camera_path(Camera_path path) -> void
+  {
+    camera_path_ = std::move(path);
+  }
 
 private:
-  std::unique_ptr<const Hitable> aggregate_ = nullptr;
-  std::vector<std::unique_ptr<Material>> materials_;
+  // Declared first, so that everything allocated in it is destroyed before
+  std::unique_ptr<Arena> arena_;
+  // Declared before the BVH, so that it outlives the chunks that refer to it
+  Arena_ptr<Geometry_cache> geometry_cache_;
+  BVH bvh_;
+  std::pmr::vector<Material> materials_;
+  std::pmr::vector<Arena_ptr<Texture>> textures_;
+  float built_sah_cost_ = 0;
+  Camera_settings camera_;
+  std::optional<Camera_path> camera_path_;
 };
 
 } // namespace lesty
@@ -3,14 +3,44 @@
 #ifndef LESTY_SCENE_PARSER_HPP
 #define LESTY_SCENE_PARSER_HPP
 
+#include <filesystem>
 #include <fstream>
+#include <string_view>
 
 #include "scene.hpp"
 
 namespace lesty {
 
-[[nodiscard]] auto parse_scene(std::ifstream& file) -> Scene;
+/**
+ * @brief Parses a scene file
+ * @param directory Directory of the scene file, which the relative paths of
+ * textures and baked meshes are resolved against
+ */
+[[nodiscard]] auto parse_scene(std::ifstream& file,
+                               const std::filesystem::path& directory)
+    -> Scene;
 
-}
+/**
+ * @brief Parses a standalone camera path file
+ *
+ * The file has the same format as the "camera_path" entry of a scene file.
+ * @param base_settings Camera settings that the first keyframe does not
+ * specify fall back to
+ */
+[[nodiscard]] auto parse_camera_path(std::ifstream& file,
+                                     const Camera_settings& base_settings)
+    -> Camera_path;
+
+/**
+ * @brief Parses a JSON object in the format of the "camera" entry of a scene
+ * file
+ * @param base_settings Settings that the object does not specify fall back to
+ * @throw std::exception if the JSON is invalid
+ */
+[[nodiscard]] auto parse_camera_update(std::string_view json,
+                                       const Camera_settings& base_settings)
+    -> Camera_settings;
+
+} // namespace lesty
 
 #endif // LESTY_SCENE_PARSER_HPP
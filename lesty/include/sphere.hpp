@@ -7,33 +7,50 @@
 #define LESTY_SPHERE_HPP
 
 #include <cassert>
-#include <optional>
+#include <cstdint>
 
 #include "hitable.hpp"
-#include "material.hpp"
 
 namespace lesty {
 
 struct Sphere : Hitable {
-  beyond::Point3 center{};
+  beyond::Point3 center{}; ///< Center of the sphere at time 0
   float radius = 1;
 
-  Sphere(beyond::Point3 c, float r, const Material& mat)
-      : center{c}, radius{r}, material{&mat}
+  /// Displacement of the center per unit of time, for motion blur
+  beyond::Vec3 velocity{};
+
+  Sphere(beyond::Point3 c, float r, std::uint32_t material)
+      : center{c}, radius{r}, material_index{material}
+  {
+  }
+
+  /**
+   * @brief Gets the center of the sphere at certain time
+   */
+  [[nodiscard]] auto center_at(float time) const noexcept -> beyond::Point3
   {
+    return center + time * velocity;
   }
 
+  /**
+   * @brief Gets the bounding box of the sphere
+   *
+   * For a moving sphere, the box covers the motion in the [0, 1] time
+   * interval.
+   */
   [[nodiscard]] auto bounding_box() const -> AABB override;
 
   /**
    * @brief Ray-sphere intersection detection
+   * @pre The direction of the ray is a unit vector
    * @see Hitable::intersection_with
    */
-  [[nodiscard]] auto intersection_with(const Ray& r, float t_min,
-                                       float t_max) const
-      -> std::optional<HitRecord> override;
+  [[nodiscard]] auto intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const
+      -> bool override;
 
-  const Material* const material;
+  std::uint32_t material_index;
 };
 
 } // namespace lesty
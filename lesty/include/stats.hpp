@@ -0,0 +1,91 @@
+#ifndef LESTY_STATS_HPP
+#define LESTY_STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @file stats.hpp
+ * @brief Performance counters of the renderer
+ *
+ * Counters are incremented through the LESTY_STAT_* macros on a thread local
+ * Render_stats, and merged into a global total with flush_thread_stats() at
+ * the end of every tile, so the hot path never touches an atomic. Without
+ * LESTY_ENABLE_STATS, the macros expand to nothing.
+ */
+
+namespace lesty {
+
+#ifdef LESTY_ENABLE_STATS
+inline constexpr bool stats_enabled = true;
+#else
+inline constexpr bool stats_enabled = false;
+#endif
+
+struct Render_stats {
+  /// Rays of deeper bounces are counted in the last bucket
+  static constexpr std::size_t depth_buckets = 16;
+
+  enum Primitive : std::size_t { sphere, triangle, rect, primitive_count };
+
+  enum Path_end : std::size_t {
+    escaped,   ///< Left the scene without hitting anything
+    absorbed,  ///< Hit a material that does not scatter
+    max_depth, ///< Reached the maximum depth of the path tracer
+    path_end_count
+  };
+
+  std::array<std::uint64_t, depth_buckets> rays_per_depth{};
+  std::uint64_t bvh_node_visits = 0; ///< Also the number of box tests
+  std::array<std::uint64_t, primitive_count> primitive_tests{};
+  std::array<std::uint64_t, path_end_count> path_ends{};
+
+  auto operator+=(const Render_stats& rhs) noexcept -> Render_stats&;
+
+  [[nodiscard]] auto total_rays() const noexcept -> std::uint64_t;
+};
+
+// Defined in the header, so that the increments of the macros are inlined
+inline thread_local Render_stats thread_render_stats;
+
+/**
+ * @brief Gets the counters of the calling thread
+ */
+[[nodiscard]] inline auto thread_stats() noexcept -> Render_stats&
+{
+  return thread_render_stats;
+}
+
+/**
+ * @brief Adds the counters of the calling thread to the global total and
+ * resets them
+ */
+auto flush_thread_stats() -> void;
+
+/**
+ * @brief Gets the global total of all flushed counters
+ */
+[[nodiscard]] auto global_stats() -> Render_stats;
+
+auto reset_global_stats() -> void;
+
+/**
+ * @brief Formats the counters and the rates derived from them as JSON
+ */
+[[nodiscard]] auto stats_to_json(const Render_stats& stats,
+                                 std::chrono::duration<double> elapsed_time)
+    -> std::string;
+
+} // namespace lesty
+
+#ifdef LESTY_ENABLE_STATS
+#define LESTY_STAT_INC(counter) (++::lesty::thread_stats().counter)
+#define LESTY_STAT_ADD(counter, n) (::lesty::thread_stats().counter += (n))
+#else
+#define LESTY_STAT_INC(counter) static_cast<void>(0)
+#define LESTY_STAT_ADD(counter, n) static_cast<void>(0)
+#endif
+
+#endif // LESTY_STATS_HPP
@@ -0,0 +1,161 @@
+#ifndef LESTY_TEXTURE_HPP
+#define LESTY_TEXTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <beyond/core/math/vector.hpp>
+
+#include "arena.hpp"
+#include "color.hpp"
+
+/**
+ * @file texture.hpp
+ * @brief Mip-mapped image textures
+ *
+ * Texels are stored in tiles of 8x8, so that the four texels of a bilinear
+ * lookup, and the lookups of nearby rays, usually share cache lines. LDR
+ * images are kept as 8-bit sRGB and decoded through a table, which is four
+ * times smaller than linear floats, HDR images are kept as linear floats.
+ */
+
+namespace lesty {
+
+/// Texture index of materials without texture
+inline constexpr std::uint32_t no_texture =
+    std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * @brief Decodes an 8-bit sRGB value to linear through a lookup table
+ */
+[[nodiscard]] auto srgb8_to_linear(std::uint8_t value) noexcept -> float;
+
+class Texture {
+public:
+  enum class Format : std::uint8_t {
+    srgb8,        ///< 8-bit sRGB texels
+    linear_float, ///< Linear float texels, for HDR images
+  };
+
+  static constexpr std::size_t tile_size = 8;
+
+  /**
+   * @brief Creates a texture from linear pixels
+   * @param pixels Row-major pixels, with the top row first
+   * @pre pixels.size() == width * height
+   */
+  Texture(std::size_t width, std::size_t height, std::span<const Color> pixels,
+          Format format);
+
+  /**
+   * @brief Creates a texture from an image file that is only decoded when it
+   * is first looked up
+   *
+   * Reads the header of the image to get its size.
+   *
+   * @throw Cannot_read_file if the image cannot be opened or is not supported
+   */
+  explicit Texture(std::string filename);
+
+  Texture(const Texture&) = delete;
+  auto operator=(const Texture&) -> Texture& = delete;
+
+  [[nodiscard]] auto width() const noexcept -> std::size_t
+  {
+    return width_;
+  }
+
+  [[nodiscard]] auto height() const noexcept -> std::size_t
+  {
+    return height_;
+  }
+
+  /**
+   * @brief Number of mip levels of the full chain, down to 1x1
+   */
+  [[nodiscard]] auto level_count() const noexcept -> std::size_t;
+
+  /**
+   * @brief Finest mip level that gets loaded
+   */
+  [[nodiscard]] auto first_level() const noexcept -> std::size_t
+  {
+    return first_level_;
+  }
+
+  /**
+   * @brief Skips the mip levels finer than level to save memory
+   * @warning Only has effects before the texture is loaded
+   */
+  auto set_first_level(std::size_t level) noexcept -> void;
+
+  /**
+   * @brief Memory used by the texels of the levels from first_level() on
+   */
+  [[nodiscard]] auto memory_size() const noexcept -> std::size_t;
+
+  /**
+   * @brief Looks up the texture with a trilinear filter
+   *
+   * Coordinates wrap around, and (0, 0) is the bottom left corner.
+   *
+   * An image that fails to decode or to fit in memory prints a warning and
+   * turns magenta, rather than stopping the render halfway.
+   *
+   * @param footprint Width of the area to filter in uv units, chooses the mip
+   * level
+   */
+  [[nodiscard]] auto lookup(beyond::Point2 uv, float footprint) const -> Color;
+
+private:
+  struct Level {
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t tiles_x = 0;
+    std::vector<std::uint32_t> srgb_texels; ///< RGBX, 8 bits per channel
+    std::vector<Color> linear_texels;
+
+    [[nodiscard]] auto index(std::size_t x, std::size_t y) const noexcept
+        -> std::size_t;
+  };
+
+  auto load() const -> void;
+  // Returns false if the image cannot be decoded
+  [[nodiscard]] auto load_levels() const -> bool;
+  auto build_levels(std::span<const Color> pixels, std::size_t width,
+                    std::size_t height, std::size_t first_level) const -> void;
+  [[nodiscard]] auto texel(const Level& level, std::ptrdiff_t x,
+                           std::ptrdiff_t y) const noexcept -> Color;
+  [[nodiscard]] auto bilinear(std::size_t level, beyond::Point2 uv) const
+      noexcept -> Color;
+
+  std::string filename_;
+  std::size_t width_ = 0;
+  std::size_t height_ = 0;
+  Format format_ = Format::srgb8;
+  std::size_t first_level_ = 0;
+
+  // Filled on the first lookup
+  mutable std::once_flag loaded_;
+  mutable std::vector<Level> levels_;
+};
+
+/**
+ * @brief Limits the memory of textures by dropping their finest mip levels
+ *
+ * The finest level of the largest texture is dropped until everything fits,
+ * so that no texture loses detail while another texture keeps a larger level.
+ *
+ * @warning Needs to be called before the textures are loaded
+ */
+auto fit_memory_budget(std::span<const Arena_ptr<Texture>> textures,
+                       std::size_t budget) -> void;
+
+} // namespace lesty
+
+#endif // LESTY_TEXTURE_HPP
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <vector>
 
+#include "aov.hpp"
 #include "color.hpp"
 
 namespace lesty {
@@ -40,6 +41,77 @@ public:
     return data_[j * width_ + i];
   }
 
+  /**
+   * @brief Allocates the per pixel costs, which are not recorded by default
+   */
+  auto enable_costs() -> void
+  {
+    costs_.resize(width_ * height_);
+  }
+
+  [[nodiscard]] auto has_costs() const -> bool
+  {
+    return !costs_.empty();
+  }
+
+  /**
+   * @brief Gets the time in seconds spent on pixel (i, j)
+   * @pre has_costs()
+   */
+  [[nodiscard]] auto cost_at(size_t i, size_t j) const -> float
+  {
+    assert(has_costs() && i < width_ && j < height_);
+    return costs_[j * width_ + i];
+  }
+
+  [[nodiscard]] auto cost_at(size_t i, size_t j) -> float&
+  {
+    assert(has_costs() && i < width_ && j < height_);
+    return costs_[j * width_ + i];
+  }
+
+  /**
+   * @brief Allocates the AOVs of the first hits, which are not recorded by
+   * default
+   */
+  auto enable_aovs(Aov_set aovs) -> void
+  {
+    aovs_ = Aov_buffers{aovs, width_, height_};
+  }
+
+  [[nodiscard]] auto has_aovs() const -> bool
+  {
+    return !aovs_.empty();
+  }
+
+  /**
+   * @brief Gets the AOVs of the tile, where pixel (i, j) of the tile is at
+   * (i, j)
+   */
+  [[nodiscard]] auto aovs() const -> const Aov_buffers&
+  {
+    return aovs_;
+  }
+
+  [[nodiscard]] auto aovs() -> Aov_buffers&
+  {
+    return aovs_;
+  }
+
+  /**
+   * @brief Number of samples of every pixel of the tile, fewer than the
+   * samples per pixel of the renderer if the render was stopped
+   */
+  [[nodiscard]] auto sample_count() const -> size_t
+  {
+    return sample_count_;
+  }
+
+  auto set_sample_count(size_t sample_count) -> void
+  {
+    sample_count_ = sample_count;
+  }
+
   [[nodiscard]] auto height() const -> size_t
   {
     return height_;
@@ -62,7 +134,10 @@ private:
   size_t start_y_ = 0;
   size_t width_ = 0;
   size_t height_ = 0;
+  size_t sample_count_ = 0;
   std::vector<Color> data_{};
+  std::vector<float> costs_{};
+  Aov_buffers aovs_{};
 };
 
 } // namespace lesty
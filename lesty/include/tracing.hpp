@@ -0,0 +1,93 @@
+#ifndef LESTY_TRACING_HPP
+#define LESTY_TRACING_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+/**
+ * @file tracing.hpp
+ * @brief Scoped trace zones that are written as Chrome trace events
+ *
+ * Zones are declared with LESTY_TRACE_SCOPE and only recorded between
+ * start_tracing() and write_trace(). The result can be opened in
+ * chrome://tracing or Perfetto. Without LESTY_ENABLE_TRACING, the macros
+ * expand to nothing.
+ */
+
+namespace lesty {
+
+#ifdef LESTY_ENABLE_TRACING
+inline constexpr bool tracing_enabled = true;
+#else
+inline constexpr bool tracing_enabled = false;
+#endif
+
+/**
+ * @brief Starts recording trace zones, timestamps are relative to this call
+ */
+auto start_tracing() -> void;
+
+/**
+ * @brief Stops recording and writes all zones recorded so far
+ * @throw Cannot_write_file if the file cannot be written
+ */
+auto write_trace(const std::string& filename) -> void;
+
+/**
+ * @brief A detail of a trace zone, such as the position of a tile
+ */
+struct Trace_arg {
+  const char* name; ///< Needs to outlive the trace
+  std::uint64_t value;
+};
+
+constexpr std::size_t max_trace_args = 2;
+
+/**
+ * @brief Records the duration of a zone from its construction to its
+ * destruction on the calling thread
+ *
+ * The arguments are only formatted when the trace is written, so a zone costs
+ * a relaxed atomic load when no trace is recorded.
+ */
+class Trace_scope {
+public:
+  /**
+   * @param name Name of the zone, needs to outlive the trace
+   * @param args At most max_trace_args details of the zone
+   */
+  explicit Trace_scope(const char* name,
+                       std::initializer_list<Trace_arg> args = {}) noexcept;
+  ~Trace_scope();
+
+  Trace_scope(const Trace_scope&) = delete;
+  auto operator=(const Trace_scope&) -> Trace_scope& = delete;
+
+private:
+  const char* name_;
+  std::array<Trace_arg, max_trace_args> args_{};
+  std::size_t arg_count_ = 0;
+  std::chrono::steady_clock::time_point start_;
+  bool active_;
+};
+
+} // namespace lesty
+
+#define LESTY_TRACE_CONCAT_IMPL(a, b) a##b
+#define LESTY_TRACE_CONCAT(a, b) LESTY_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef LESTY_ENABLE_TRACING
+#define LESTY_TRACE_SCOPE(...)                                                 \
+  const ::lesty::Trace_scope LESTY_TRACE_CONCAT(lesty_trace_scope_, __LINE__)  \
+  {                                                                            \
+    __VA_ARGS__                                                                \
+  }
+#else
+#define LESTY_TRACE_SCOPE(...) static_cast<void>(0)
+#endif
+
+#endif // LESTY_TRACING_HPP
@@ -5,28 +5,31 @@
 
 #include <array>
 #include <beyond/core/math/vector.hpp>
-#include <optional>
+#include <cstdint>
 
 #include "hitable.hpp"
-#include "material.hpp"
 
 namespace lesty {
 
 struct Triangle : Hitable {
   std::array<beyond::Point3, 3> vertices{};
-  const Material* material;
+  std::uint32_t material_index;
+
+  /// Texture coordinates of the vertices
+  std::array<beyond::Point2, 3> uvs{
+      {beyond::Point2{0, 0}, beyond::Point2{1, 0}, beyond::Point2{0, 1}}};
 
   Triangle(const beyond::Point3& p1, const beyond::Point3& p2,
-           const beyond::Point3& p3, const Material& mat)
-      : vertices{p1, p2, p3}, material{&mat}
+           const beyond::Point3& p3, std::uint32_t material)
+      : vertices{p1, p2, p3}, material_index{material}
   {
   }
 
   [[nodiscard]] auto bounding_box() const -> AABB override;
 
-  [[nodiscard]] auto intersection_with(const Ray& r, float t_min,
-                                       float t_max) const
-      -> std::optional<HitRecord> override;
+  [[nodiscard]] auto intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const
+      -> bool override;
 
   // Calculate the normal of a triangle
   [[nodiscard]] constexpr auto normal() const -> beyond::Vec3;
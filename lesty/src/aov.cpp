@@ -0,0 +1,94 @@
+#include "aov.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Values of the pixels where nothing is hit
+auto miss_value(lesty::Aov aov) noexcept -> float
+{
+  switch (aov) {
+  case lesty::Aov::depth:
+    return std::numeric_limits<float>::infinity();
+  case lesty::Aov::primitive_id:
+  case lesty::Aov::material_id:
+    return -1;
+  case lesty::Aov::normal:
+  case lesty::Aov::albedo:
+    break;
+  }
+  return 0;
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto aov_name(Aov aov) noexcept -> std::string_view
+{
+  switch (aov) {
+  case Aov::depth:
+    return "depth";
+  case Aov::normal:
+    return "normal";
+  case Aov::albedo:
+    return "albedo";
+  case Aov::primitive_id:
+    return "primitive_id";
+  case Aov::material_id:
+    return "material_id";
+  }
+  return "";
+}
+
+auto parse_aov(std::string_view name) -> std::optional<Aov>
+{
+  const auto found =
+      std::find_if(all_aovs.begin(), all_aovs.end(),
+                   [name](Aov aov) { return aov_name(aov) == name; });
+  if (found == all_aovs.end()) {
+    return std::nullopt;
+  }
+  return *found;
+}
+
+Aov_buffers::Aov_buffers(Aov_set aovs, std::size_t width, std::size_t height)
+    : aovs_{aovs}, width_{width}, height_{height}
+{
+  const auto plane_size = width * height;
+  std::size_t size = 0;
+  for (const auto aov : all_aovs) {
+    if (aovs.contains(aov)) {
+      first_planes_[static_cast<std::size_t>(aov)] = size;
+      size += channel_count(aov) * plane_size;
+    }
+  }
+
+  data_.resize(size);
+  for (const auto aov : all_aovs) {
+    if (aovs.contains(aov)) {
+      for (std::size_t channel = 0; channel < channel_count(aov); ++channel) {
+        std::ranges::fill(plane(aov, channel), miss_value(aov));
+      }
+    }
+  }
+}
+
+auto Aov_buffers::to_image(Aov aov) const -> Image
+{
+  Image image{width_, height_};
+  const bool is_color = channel_count(aov) == 3;
+  const auto r = plane(aov, 0);
+  const auto g = plane(aov, is_color ? 1 : 0);
+  const auto b = plane(aov, is_color ? 2 : 0);
+  for (std::size_t y = 0; y < height_; ++y) {
+    for (std::size_t x = 0; x < width_; ++x) {
+      const auto i = y * width_ + x;
+      image.color_at(x, y) = Color{r[i], g[i], b[i]};
+    }
+  }
+  return image;
+}
+
+} // namespace lesty
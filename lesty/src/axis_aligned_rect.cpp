@@ -1,4 +1,7 @@
+#include <cmath>
+
 #include "axis_aligned_rect.hpp"
+#include "stats.hpp"
 
 namespace {
 
@@ -8,65 +11,90 @@ constexpr beyond::Vec3 flip_negative_normal(beyond::Vec3 normal,
   return d == lesty::NormalDirection::Negetive ? -normal : normal;
 }
 
+// Stretches the texture over the whole rect
+auto set_rect_uv(lesty::HitRecord& record, float a, float b,
+                 beyond::Point2 min, beyond::Point2 max) noexcept -> void
+{
+  const float width = max.x - min.x;
+  const float height = max.y - min.y;
+  record.uv = {(a - min.x) / width, (b - min.y) / height};
+  record.uv_scale = 1 / std::sqrt(width * height);
+}
+
 } // anonymous namespace
 
 namespace lesty {
 
-[[nodiscard]] Maybe_hit_t Rect_XY::intersection_with(const Ray& r, float t_min,
-                                                     float t_max) const
+[[nodiscard]] bool Rect_XY::intersection_with(const Ray& r, float t_min,
+                                              float t_max,
+                                              HitRecord& record) const
 {
-  const float t = (z - r.origin.z) / r.direction.z;
+  LESTY_STAT_INC(primitive_tests[Render_stats::rect]);
+  const float t = (z - r.origin.z) * r.inv_direction.z;
   if (t < t_min || t > t_max) {
-    return {};
+    return false;
   }
 
   const float x = r.origin.x + t * r.direction.x;
   const float y = r.origin.y + t * r.direction.y;
   if (x < min.x || x > max.x || y < min.y || y > max.y) {
-    return std::nullopt;
+    return false;
   }
 
-  return HitRecord{t, r(t),
-                   flip_negative_normal(beyond::Vec3(0, 0, 1), direction),
-                   material};
+  record.t = t;
+  record.point = r(t);
+  record.normal = flip_negative_normal(beyond::Vec3(0, 0, 1), direction);
+  record.material_index = material_index;
+  set_rect_uv(record, x, y, min, max);
+  return true;
 }
 
-[[nodiscard]] Maybe_hit_t Rect_XZ::intersection_with(const Ray& r, float t_min,
-                                                     float t_max) const
+[[nodiscard]] bool Rect_XZ::intersection_with(const Ray& r, float t_min,
+                                              float t_max,
+                                              HitRecord& record) const
 {
-  const float t = (y - r.origin.y) / r.direction.y;
+  LESTY_STAT_INC(primitive_tests[Render_stats::rect]);
+  const float t = (y - r.origin.y) * r.inv_direction.y;
   if (t < t_min || t > t_max) {
-    return {};
+    return false;
   }
 
   const float x = r.origin.x + t * r.direction.x;
   const float z = r.origin.z + t * r.direction.z;
   if (x < min.x || x > max.x || z < min.y || z > max.y) {
-    return std::nullopt;
+    return false;
   }
 
-  return HitRecord{t, r(t),
-                   flip_negative_normal(beyond::Vec3(0, 1, 0), direction),
-                   material};
+  record.t = t;
+  record.point = r(t);
+  record.normal = flip_negative_normal(beyond::Vec3(0, 1, 0), direction);
+  record.material_index = material_index;
+  set_rect_uv(record, x, z, min, max);
+  return true;
 }
 
-[[nodiscard]] Maybe_hit_t Rect_YZ::intersection_with(const Ray& r, float t_min,
-                                                     float t_max) const
+[[nodiscard]] bool Rect_YZ::intersection_with(const Ray& r, float t_min,
+                                              float t_max,
+                                              HitRecord& record) const
 {
-  const float t = (x - r.origin.x) / r.direction.x;
+  LESTY_STAT_INC(primitive_tests[Render_stats::rect]);
+  const float t = (x - r.origin.x) * r.inv_direction.x;
   if (t < t_min || t > t_max) {
-    return {};
+    return false;
   }
 
   const float y = r.origin.y + t * r.direction.y;
   const float z = r.origin.z + t * r.direction.z;
   if (y < min.x || y > max.x || z < min.y || z > max.y) {
-    return std::nullopt;
+    return false;
   }
 
-  return HitRecord{t, r(t),
-                   flip_negative_normal(beyond::Vec3(1, 0, 0), direction),
-                   material};
+  record.t = t;
+  record.point = r(t);
+  record.normal = flip_negative_normal(beyond::Vec3(1, 0, 0), direction);
+  record.material_index = material_index;
+  set_rect_uv(record, y, z, min, max);
+  return true;
 }
 
 } // namespace lesty
\ No newline at end of file
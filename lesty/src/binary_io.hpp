@@ -0,0 +1,40 @@
+#ifndef LESTY_BINARY_IO_HPP
+#define LESTY_BINARY_IO_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace lesty {
+
+// Binary files are always little endian
+template <typename T> void write_le(std::ofstream& file, T value)
+{
+  static_assert(std::is_arithmetic_v<T>);
+  std::array<char, sizeof(T)> bytes;
+  std::memcpy(bytes.data(), &value, sizeof(T));
+  if constexpr (std::endian::native == std::endian::big) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T> auto read_le(std::ifstream& file) -> T
+{
+  static_assert(std::is_arithmetic_v<T>);
+  std::array<char, sizeof(T)> bytes;
+  file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if constexpr (std::endian::native == std::endian::big) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  T value;
+  std::memcpy(&value, bytes.data(), sizeof(T));
+  return value;
+}
+
+} // namespace lesty
+
+#endif // LESTY_BINARY_IO_HPP
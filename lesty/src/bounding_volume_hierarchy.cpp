@@ -1,110 +1,185 @@
 #include "bounding_volume_hierarchy.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
-#include <limits>
-#include <random>
+#include <iterator>
+
+#include "stats.hpp"
+#include "tracing.hpp"
 
-// A dummy object that you cannot hit
 namespace {
-struct Never_hitable : lesty::Hitable {
-  auto bounding_box() const -> lesty::AABB override
-  {
-    constexpr auto min = std::numeric_limits<float>::min();
-    constexpr auto max = std::numeric_limits<float>::max();
-
-    // Returns a bounding box that do not bound to anything
-    return lesty::AABB{
-        {max, max, max}, {min, min, min}, lesty::AABB::unchecked_tag};
-  }
 
-  auto intersection_with(const lesty::Ray& /*r*/, float /*t_min*/,
-                         float /*t_max*/) const
-      -> std::optional<lesty::HitRecord> override
-  {
-    return {};
-  }
-};
+// Maximum number of primitives stored in a leaf
+constexpr std::size_t max_leaf_size = 2;
+
+// The axes of the splits are chosen at random, from a fixed seed so that the
+// same primitives always give the same hierarchy
+constexpr std::uint64_t split_axis_seed = 0x6c657374;
+
+// Relative costs of the surface area heuristic
+constexpr float traversal_cost = 1;
+constexpr float intersection_cost = 1;
+
 } // anonymous namespace
 
 namespace lesty {
 
-BVH_node::BVH_node(const ObjectIterator& begin,
-                   const ObjectIterator& end) noexcept
+BVH::BVH(std::vector<Arena_ptr<Hitable>>&& objects,
+         std::pmr::memory_resource* resource)
+    : objects_{std::make_move_iterator(objects.begin()),
+               std::make_move_iterator(objects.end()), resource},
+      nodes_{resource}
+{
+  // A binary tree with at most max_leaf_size primitives per leaf has less
+  // than 2n nodes, so rebuilds never reallocate
+  nodes_.reserve(2 * objects_.size());
+  rebuild();
+}
+
+auto BVH::rebuild() -> void
 {
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-  std::uniform_int_distribution<int> dis(0, 2);
-  int axis = dis(gen);
-  if (axis == 0) {
-    // Sort by x
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box().min().x <
-                       rhs->bounding_box().min().x;
-              });
-  } else if (axis == 1) {
-    // Sort by y
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box().min().y <
-                       rhs->bounding_box().min().y;
-              });
-  } else {
-    // Sort by z
-    std::sort(begin, end,
-              [](const std::unique_ptr<Hitable>& lhs,
-                 const std::unique_ptr<Hitable>& rhs) {
-                return lhs->bounding_box().min().z <
-                       rhs->bounding_box().min().z;
-              });
+  nodes_.clear();
+  if (objects_.empty()) {
+    return;
   }
 
+  LESTY_TRACE_SCOPE("build_bvh", {{"primitives", objects_.size()}});
+
+  Rng rng{split_axis_seed};
+  build(0, objects_.size(), rng);
+}
+
+auto BVH::build(std::size_t begin, std::size_t end, Rng& rng) -> void
+{
   const auto size = end - begin;
   assert(size > 0);
 
-  switch (size) {
-  case 1:
-    left_ = std::move(*begin);
-    right_ = std::make_unique<Never_hitable>();
-    break;
-  case 2:
-    left_ = std::move(*begin);
-    right_ = std::move(*(begin + 1));
-    break;
-  default:
-    left_ = std::make_unique<BVH_node>(begin, begin + size / 2);
-    right_ = std::make_unique<BVH_node>(begin + size / 2, end);
+  const auto node_index = nodes_.size();
+  nodes_.emplace_back();
+
+  if (size <= max_leaf_size) {
+    auto& leaf = nodes_[node_index];
+    leaf.offset = static_cast<std::uint32_t>(begin);
+    leaf.primitive_count = static_cast<std::uint16_t>(size);
+    leaf.box = objects_[begin]->bounding_box();
+    for (auto i = begin + 1; i < end; ++i) {
+      leaf.box = aabb_union(leaf.box, objects_[i]->bounding_box());
+    }
+    return;
   }
 
-  box_ = aabb_union(left_->bounding_box(), right_->bounding_box());
+  const auto axis = static_cast<std::size_t>(rng() % 3);
+
+  const auto first = objects_.begin() + static_cast<std::ptrdiff_t>(begin);
+  const auto last = objects_.begin() + static_cast<std::ptrdiff_t>(end);
+  std::sort(first, last,
+            [axis](const Arena_ptr<Hitable>& lhs,
+                   const Arena_ptr<Hitable>& rhs) {
+              return lhs->bounding_box().min()[axis] <
+                     rhs->bounding_box().min()[axis];
+            });
+
+  const auto mid = begin + size / 2;
+  build(begin, mid, rng);
+  const auto right_index = nodes_.size();
+  build(mid, end, rng);
+
+  // The reference is taken after the recursion because building the
+  // children may reallocate nodes_
+  auto& node = nodes_[node_index];
+  node.offset = static_cast<std::uint32_t>(right_index);
+  node.axis = static_cast<std::uint8_t>(axis);
+  node.box = aabb_union(nodes_[node_index + 1].box, nodes_[right_index].box);
+}
+
+auto BVH::refit() noexcept -> void
+{
+  // Children are always stored after their parent, so a reverse sweep visits
+  // every node after both of its children
+  for (auto i = nodes_.size(); i-- > 0;) {
+    auto& node = nodes_[i];
+    if (node.is_leaf()) {
+      const auto begin = node.offset;
+      const auto end = begin + node.primitive_count;
+      node.box = objects_[begin]->bounding_box();
+      for (auto j = begin + 1; j < end; ++j) {
+        node.box = aabb_union(node.box, objects_[j]->bounding_box());
+      }
+    } else {
+      node.box = aabb_union(nodes_[i + 1].box, nodes_[node.offset].box);
+    }
+  }
 }
 
-auto BVH_node::intersection_with(const Ray& r, float t_min, float t_max) const
-    noexcept -> std::optional<HitRecord>
+auto BVH::sah_cost() const noexcept -> float
 {
-  assert(left_ != nullptr && right_ != nullptr);
+  // Normalizes by the area of the primitives rather than the area of the root,
+  // since the latter changes when primitives move
+  float primitive_area = 0;
+  for (const auto& object : objects_) {
+    primitive_area += object->bounding_box().surface_area();
+  }
+  if (primitive_area <= 0) {
+    return 0;
+  }
+
+  float cost = 0;
+  for (const auto& node : nodes_) {
+    const float area = node.box.surface_area() / primitive_area;
+    cost += node.is_leaf() ? area * intersection_cost *
+                                 static_cast<float>(node.primitive_count)
+                           : area * traversal_cost;
+  }
+  return cost;
+}
 
-  if (!box_.hit(r, t_min, t_max)) {
-    return {};
+auto BVH::intersection_with(const Ray& r, float t_min, float t_max,
+                            HitRecord& record) const noexcept -> bool
+{
+  if (nodes_.empty()) {
+    return false;
   }
 
-  const auto hit_left_record = left_->intersection_with(r, t_min, t_max);
-  const auto hit_right_record = right_->intersection_with(r, t_min, t_max);
-  if (hit_left_record && hit_right_record) {
-    if (hit_left_record->t < hit_right_record->t) {
-      return hit_left_record;
+  // Median splits keep the depth of the tree at about log2(n)
+  std::array<std::uint32_t, 64> stack;
+  std::size_t stack_size = 0;
+  stack[stack_size++] = 0;
+
+  // Primitives write into record directly, every hit shrinks t_max so that
+  // only closer hits overwrite it
+  bool hit = false;
+  while (stack_size > 0) {
+    const auto index = stack[--stack_size];
+    const auto& node = nodes_[index];
+    // Every visit tests the box of the node
+    LESTY_STAT_INC(bvh_node_visits);
+    if (!node.box.hit(r, t_min, t_max)) {
+      continue;
+    }
+
+    if (node.is_leaf()) {
+      const auto end = node.offset + node.primitive_count;
+      for (auto i = node.offset; i < end; ++i) {
+        if (objects_[i]->intersection_with(r, t_min, t_max, record)) {
+          t_max = record.t;
+          record.primitive_index = i;
+          hit = true;
+        }
+      }
     } else {
-      return hit_right_record;
+      assert(stack_size + 2 <= stack.size());
+      // Push the far child first so that the near child get visited first
+      if (r.direction[node.axis] < 0) {
+        stack[stack_size++] = index + 1;
+        stack[stack_size++] = node.offset;
+      } else {
+        stack[stack_size++] = node.offset;
+        stack[stack_size++] = index + 1;
+      }
     }
-  } else if (hit_left_record) {
-    return hit_left_record;
-  } else if (hit_right_record) {
-    return hit_right_record;
-  } else {
-    return {};
   }
+  return hit;
 }
 
-} // namespace lesty
\ No newline at end of file
+} // namespace lesty
@@ -0,0 +1,140 @@
+#include "denoise.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.hpp"
+#include "tracing.hpp"
+
+namespace {
+
+using lesty::Color;
+
+// Weights of the 5x5 B3 spline kernel along one axis
+constexpr std::array<float, 5> kernel = {1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4,
+                                         1.f / 16};
+
+// Keeps black albedos from dividing by 0
+constexpr Color albedo_epsilon{1e-3f, 1e-3f, 1e-3f};
+
+[[nodiscard]] auto squared_distance(const Color& lhs, const Color& rhs) noexcept
+    -> float
+{
+  const auto d = lhs - rhs;
+  const auto d2 = d * d;
+  return d2.r + d2.g + d2.b;
+}
+
+// Guides of the filter, divided by their squared sigma in advance
+struct Edge_stops {
+  float color;
+  float normal;
+  float albedo;
+};
+
+// Filters the rows [begin, end) of source into destination with the kernel
+// spread step pixels apart
+void filter_rows(const std::vector<Color>& source,
+                 std::vector<Color>& destination,
+                 const std::vector<Color>& albedo,
+                 const std::vector<Color>& normals, std::size_t width,
+                 std::size_t height, std::size_t step, Edge_stops stops,
+                 std::size_t begin, std::size_t end)
+{
+  const auto signed_step = static_cast<std::ptrdiff_t>(step);
+  const auto signed_width = static_cast<std::ptrdiff_t>(width);
+  const auto signed_height = static_cast<std::ptrdiff_t>(height);
+
+  for (auto y = begin; y < end; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      const auto center = y * width + x;
+      const auto& center_color = source[center];
+      const auto& center_normal = normals[center];
+      const auto& center_albedo = albedo[center];
+
+      Color sum;
+      float weight_sum = 0;
+      for (std::ptrdiff_t dy = -2; dy <= 2; ++dy) {
+        const auto qy = static_cast<std::ptrdiff_t>(y) + dy * signed_step;
+        if (qy < 0 || qy >= signed_height) {
+          continue;
+        }
+        for (std::ptrdiff_t dx = -2; dx <= 2; ++dx) {
+          const auto qx = static_cast<std::ptrdiff_t>(x) + dx * signed_step;
+          if (qx < 0 || qx >= signed_width) {
+            continue;
+          }
+          const auto q = static_cast<std::size_t>(qy * signed_width + qx);
+          const auto& color = source[q];
+          const float distance =
+              squared_distance(center_color, color) * stops.color +
+              squared_distance(center_normal, normals[q]) * stops.normal +
+              squared_distance(center_albedo, albedo[q]) * stops.albedo;
+          const float weight = kernel[static_cast<std::size_t>(dx + 2)] *
+                               kernel[static_cast<std::size_t>(dy + 2)] *
+                               std::exp(-distance);
+          sum += color * weight;
+          weight_sum += weight;
+        }
+      }
+      // The center always has a weight, so weight_sum is positive
+      destination[center] = sum / weight_sum;
+    }
+  }
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto denoise(const Image& color, const Image& albedo, const Image& normals,
+             const Denoise_options& options) -> Image
+{
+  const auto width = color.width();
+  const auto height = color.height();
+  if (albedo.width() != width || albedo.height() != height ||
+      normals.width() != width || normals.height() != height) {
+    throw std::invalid_argument{
+        "The guides of the denoiser do not match the size of the image"};
+  }
+
+  LESTY_TRACE_SCOPE("denoise");
+  const auto& albedo_data = albedo.data();
+  const auto pixel_count = width * height;
+
+  // The illumination, which is smooth even on textured surfaces
+  std::vector<Color> source(pixel_count);
+  for (std::size_t i = 0; i < pixel_count; ++i) {
+    source[i] = color.data()[i] / (albedo_data[i] + albedo_epsilon);
+  }
+  std::vector<Color> destination(pixel_count);
+
+  float color_sigma = options.color_sigma;
+  for (std::size_t i = 0; i < options.iterations; ++i) {
+    const Edge_stops stops{
+        1 / (color_sigma * color_sigma),
+        1 / (options.normal_sigma * options.normal_sigma),
+        1 / (options.albedo_sigma * options.albedo_sigma)};
+    const std::size_t step = std::size_t{1} << i;
+    parallel_for_rows(height, [&](std::size_t begin, std::size_t end) {
+      filter_rows(source, destination, albedo_data, normals.data(), width,
+                  height, step, stops, begin, end);
+    });
+    std::swap(source, destination);
+    color_sigma /= 2;
+  }
+
+  Image result{width, height};
+  result.set_sample_count(color.sample_count());
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      const auto i = y * width + x;
+      result.color_at(x, y) = source[i] * (albedo_data[i] + albedo_epsilon);
+    }
+  }
+  return result;
+}
+
+} // namespace lesty
@@ -0,0 +1,405 @@
+#include "geometry_cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "binary_io.hpp"
+#include "image.hpp"
+#include "tracing.hpp"
+#include "triangle.hpp"
+
+namespace {
+
+using lesty::Triangle_vertices;
+
+// Bytes of the header before the chunk table
+constexpr std::size_t header_size =
+    sizeof(lesty::baked_geometry_magic) + 2 * sizeof(std::uint32_t);
+constexpr std::size_t chunk_entry_size =
+    6 * sizeof(float) + 2 * sizeof(std::uint64_t);
+constexpr std::size_t triangle_size = 9 * sizeof(float);
+
+// Estimated bytes of a loaded triangle, including its BVH nodes
+constexpr std::size_t bytes_per_triangle =
+    sizeof(lesty::Triangle) + sizeof(lesty::Arena_ptr<lesty::Hitable>) +
+    2 * sizeof(lesty::BVH_node);
+
+auto centroid(const Triangle_vertices& triangle, std::size_t axis) noexcept
+    -> float
+{
+  return triangle[0][axis] + triangle[1][axis] + triangle[2][axis];
+}
+
+auto bounds_of(std::span<const Triangle_vertices> triangles,
+               std::span<const std::size_t> indices) noexcept -> lesty::AABB
+{
+  lesty::AABB bounds{triangles[indices.front()][0]};
+  for (const auto index : indices) {
+    for (const auto& vertex : triangles[index]) {
+      bounds = aabb_union(bounds, lesty::AABB{vertex});
+    }
+  }
+  return bounds;
+}
+
+auto write_point(std::ofstream& file, beyond::Point3 p) -> void
+{
+  lesty::write_le(file, p.x);
+  lesty::write_le(file, p.y);
+  lesty::write_le(file, p.z);
+}
+
+auto read_point(std::ifstream& file) -> beyond::Point3
+{
+  const auto x = lesty::read_le<float>(file);
+  const auto y = lesty::read_le<float>(file);
+  const auto z = lesty::read_le<float>(file);
+  return {x, y, z};
+}
+
+// The cache that the thread holds a Read_guard of
+thread_local const lesty::Geometry_cache* guarded_cache = nullptr;
+
+} // anonymous namespace
+
+namespace lesty {
+
+struct Geometry_chunk::Geometry {
+  // Declared first, so that everything allocated in it is destroyed before
+  std::unique_ptr<Arena> arena;
+  BVH bvh;
+  std::size_t memory_size = 0;
+};
+
+auto bake_geometry(const std::string& filename,
+                   std::span<const Triangle_vertices> triangles,
+                   std::size_t triangles_per_chunk) -> void
+{
+  LESTY_TRACE_SCOPE("bake_geometry");
+  assert(triangles_per_chunk > 0);
+
+  std::vector<std::size_t> indices(triangles.size());
+  std::iota(indices.begin(), indices.end(), std::size_t{0});
+
+  // Ranges of indices that become chunks, in depth-first order so that
+  // neighbouring chunks are close in the file
+  std::vector<std::pair<std::size_t, std::size_t>> chunks;
+  std::vector<std::pair<std::size_t, std::size_t>> stack;
+  if (!indices.empty()) {
+    stack.emplace_back(0, indices.size());
+  }
+  while (!stack.empty()) {
+    const auto [begin, end] = stack.back();
+    stack.pop_back();
+    if (end - begin <= triangles_per_chunk) {
+      chunks.emplace_back(begin, end);
+      continue;
+    }
+
+    std::array<float, 3> min;
+    std::array<float, 3> max;
+    min.fill(std::numeric_limits<float>::infinity());
+    max.fill(-std::numeric_limits<float>::infinity());
+    for (auto i = begin; i < end; ++i) {
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        const auto c = centroid(triangles[indices[i]], axis);
+        min[axis] = std::min(min[axis], c);
+        max[axis] = std::max(max[axis], c);
+      }
+    }
+    std::size_t axis = 0;
+    for (std::size_t a = 1; a < 3; ++a) {
+      if (max[a] - min[a] > max[axis] - min[axis]) {
+        axis = a;
+      }
+    }
+
+    const auto mid = begin + (end - begin) / 2;
+    const auto first = indices.begin();
+    std::nth_element(first + static_cast<std::ptrdiff_t>(begin),
+                     first + static_cast<std::ptrdiff_t>(mid),
+                     first + static_cast<std::ptrdiff_t>(end),
+                     [&](std::size_t lhs, std::size_t rhs) {
+                       return centroid(triangles[lhs], axis) <
+                              centroid(triangles[rhs], axis);
+                     });
+    stack.emplace_back(mid, end);
+    stack.emplace_back(begin, mid);
+  }
+
+  std::ofstream file{filename, std::ios::binary};
+  if (!file) {
+    throw Cannot_write_file{filename.c_str()};
+  }
+
+  file.write(baked_geometry_magic, sizeof(baked_geometry_magic));
+  write_le(file, baked_geometry_version);
+  write_le(file, static_cast<std::uint32_t>(chunks.size()));
+
+  std::uint64_t offset = header_size + chunks.size() * chunk_entry_size;
+  for (const auto& [begin, end] : chunks) {
+    const auto bounds = bounds_of(
+        triangles, std::span{indices}.subspan(begin, end - begin));
+    const std::uint64_t triangle_count = end - begin;
+    write_point(file, bounds.min());
+    write_point(file, bounds.max());
+    write_le(file, offset);
+    write_le(file, triangle_count);
+    offset += triangle_count * triangle_size;
+  }
+
+  for (const auto index : indices) {
+    for (const auto& vertex : triangles[index]) {
+      write_point(file, vertex);
+    }
+  }
+  if (!file) {
+    throw Cannot_write_file{filename.c_str()};
+  }
+}
+
+auto Geometry_chunk::intersection_with(const Ray& r, float t_min, float t_max,
+                                       HitRecord& record) const -> bool
+{
+  const Geometry_cache::Read_guard guard{cache_};
+  const auto* geometry = cache_->acquire(*this);
+  return geometry->bvh.intersection_with(r, t_min, t_max, record);
+}
+
+auto Geometry_chunk::is_resident() const -> bool
+{
+  return geometry_.load(std::memory_order_acquire) != nullptr;
+}
+
+Geometry_cache::Read_guard::Read_guard(Geometry_cache* cache) noexcept
+{
+  if (cache == nullptr || cache == guarded_cache) {
+    return;
+  }
+
+  // A reader that counted itself in the slot of an epoch that has moved on
+  // in the meantime may have been missed by reclaim(), so it tries again
+  while (true) {
+    const auto epoch = cache->epoch_.load();
+    cache->readers_[epoch % 2].fetch_add(1);
+    if (cache->epoch_.load() == epoch) {
+      epoch_ = epoch;
+      break;
+    }
+    cache->readers_[epoch % 2].fetch_sub(1, std::memory_order_release);
+  }
+  cache_ = cache;
+  previous_ = std::exchange(guarded_cache, cache);
+}
+
+Geometry_cache::Read_guard::~Read_guard()
+{
+  if (cache_ != nullptr) {
+    guarded_cache = previous_;
+    cache_->readers_[epoch_ % 2].fetch_sub(1, std::memory_order_release);
+  }
+}
+
+Geometry_cache::Geometry_cache(std::size_t budget) : budget_{budget} {}
+
+Geometry_cache::~Geometry_cache() = default;
+
+auto Geometry_cache::open(const std::string& filename, std::uint32_t material,
+                          Arena& arena) -> std::vector<Arena_ptr<Hitable>>
+{
+  std::ifstream file{filename, std::ios::binary};
+  if (!file) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+
+  std::array<char, sizeof(baked_geometry_magic)> magic{};
+  file.read(magic.data(), magic.size());
+  const auto version = read_le<std::uint32_t>(file);
+  const auto chunk_count = read_le<std::uint32_t>(file);
+  if (!file || !std::equal(magic.begin(), magic.end(), baked_geometry_magic) ||
+      version != baked_geometry_version) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+
+  std::uint32_t file_index = 0;
+  {
+    const std::scoped_lock lock{mutex_};
+    file_index = static_cast<std::uint32_t>(filenames_.size());
+    filenames_.push_back(filename);
+  }
+
+  std::vector<Arena_ptr<Hitable>> chunks;
+  chunks.reserve(chunk_count);
+  for (std::uint32_t i = 0; i < chunk_count; ++i) {
+    const auto min = read_point(file);
+    const auto max = read_point(file);
+    const auto offset = read_le<std::uint64_t>(file);
+    const auto triangle_count = read_le<std::uint64_t>(file);
+    chunks.push_back(arena.make<Geometry_chunk>(
+        *this, file_index, AABB{min, max, AABB::unchecked_tag}, offset,
+        triangle_count, material));
+  }
+  if (!file) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+  return chunks;
+}
+
+auto Geometry_cache::budget() const -> std::size_t
+{
+  const std::scoped_lock lock{mutex_};
+  return budget_;
+}
+
+auto Geometry_cache::set_budget(std::size_t budget) -> void
+{
+  const std::scoped_lock lock{mutex_};
+  budget_ = budget;
+  evict_over_budget();
+  reclaim();
+}
+
+auto Geometry_cache::memory_size() const -> std::size_t
+{
+  const std::scoped_lock lock{mutex_};
+  return memory_size_;
+}
+
+auto Geometry_cache::load_count() const -> std::size_t
+{
+  const std::scoped_lock lock{mutex_};
+  return load_count_;
+}
+
+auto Geometry_cache::acquire(const Geometry_chunk& chunk) -> const Geometry*
+{
+  // The stamp is only written when the clock moved, so that the cache line of
+  // a chunk that many threads hit stays shared
+  const auto now = clock_.load(std::memory_order_relaxed);
+  if (const auto* geometry = chunk.geometry_.load(std::memory_order_acquire)) {
+    if (chunk.last_use_.load(std::memory_order_relaxed) != now) {
+      chunk.last_use_.store(now, std::memory_order_relaxed);
+    }
+    return geometry;
+  }
+
+  // Loads without the lock, so that threads that hit resident chunks are
+  // not blocked. Two threads may load the same chunk, then the first one wins.
+  auto geometry = load(chunk);
+
+  const std::scoped_lock lock{mutex_};
+  ++load_count_;
+  if (const auto* loaded = chunk.geometry_.load(std::memory_order_acquire)) {
+    return loaded;
+  }
+  chunk.last_use_.store(clock_.fetch_add(1, std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+  memory_size_ += geometry->memory_size;
+  const auto* result = geometry.get();
+  chunk.geometry_.store(result, std::memory_order_release);
+  resident_.emplace_back(&chunk, std::move(geometry));
+  evict_over_budget();
+  reclaim();
+  return result;
+}
+
+auto Geometry_cache::load(const Geometry_chunk& chunk) const
+    -> std::unique_ptr<const Geometry>
+{
+  LESTY_TRACE_SCOPE("load_geometry_chunk");
+
+  std::string filename;
+  {
+    const std::scoped_lock lock{mutex_};
+    filename = filenames_[chunk.file_index_];
+  }
+
+  const auto count = static_cast<std::size_t>(chunk.triangle_count_);
+  auto arena = std::make_unique<Arena>(
+      std::max(Arena::default_block_size, count * bytes_per_triangle));
+  std::vector<Arena_ptr<Hitable>> triangles;
+  triangles.reserve(count);
+
+  std::ifstream file{filename, std::ios::binary};
+  file.seekg(static_cast<std::streamoff>(chunk.offset_));
+  for (std::size_t i = 0; i < count && file; ++i) {
+    const auto p1 = read_point(file);
+    const auto p2 = read_point(file);
+    const auto p3 = read_point(file);
+    triangles.push_back(
+        arena->make<Triangle>(p1, p2, p3, chunk.material_index_));
+  }
+
+  // Rendering goes on without the chunk rather than failing in the middle of
+  // a render
+  if (!file) {
+    fmt::print(stderr, "Warning: cannot read geometry from {}\n", filename);
+    triangles.clear();
+  }
+
+  auto* resource = arena->resource();
+  return std::make_unique<const Geometry>(
+      Geometry{std::move(arena), BVH{std::move(triangles), resource},
+               std::max<std::size_t>(count, 1) * bytes_per_triangle});
+}
+
+auto Geometry_cache::evict_over_budget() -> void
+{
+  if (budget_ == 0 || memory_size_ <= budget_) {
+    return;
+  }
+
+  // Stamps keep changing while other threads render, so they are read once
+  std::vector<std::pair<std::uint64_t, Resident_chunk>> by_last_use;
+  by_last_use.reserve(resident_.size());
+  for (auto& entry : resident_) {
+    const auto last_use =
+        entry.first->last_use_.load(std::memory_order_relaxed);
+    by_last_use.emplace_back(last_use, std::move(entry));
+  }
+  resident_.clear();
+  // The most recently used chunk is at the front
+  std::ranges::sort(by_last_use, std::ranges::greater{},
+                    &std::pair<std::uint64_t, Resident_chunk>::first);
+
+  while (memory_size_ > budget_ && by_last_use.size() > 1) {
+    auto [chunk, geometry] = std::move(by_last_use.back().second);
+    by_last_use.pop_back();
+    memory_size_ -= geometry->memory_size;
+    chunk->geometry_.store(nullptr);
+    // Readers that start from now on cannot reach the geometry anymore
+    retired_.emplace_back(epoch_.load(), std::move(geometry));
+  }
+
+  for (auto& [last_use, entry] : by_last_use) {
+    resident_.push_back(std::move(entry));
+  }
+}
+
+auto Geometry_cache::reclaim() -> void
+{
+  if (retired_.empty()) {
+    return;
+  }
+
+  const auto epoch = epoch_.load();
+  if (readers_[(epoch + 1) % 2].load() != 0) {
+    return;
+  }
+  std::erase_if(retired_, [epoch](const auto& retired) {
+    return retired.first < epoch;
+  });
+  // The geometry retired in this epoch is freed once the readers of it are
+  // gone, which the next reclaim() finds out
+  if (!retired_.empty()) {
+    epoch_.store(epoch + 1);
+  }
+}
+
+} // namespace lesty
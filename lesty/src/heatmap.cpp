@@ -0,0 +1,65 @@
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Normalizes by the cost that 99.5% of the pixels stay below
+constexpr float normalization_percentile = 0.995f;
+
+// Polynomial approximation of the Turbo colormap
+// Credit: https://gist.github.com/mikhailov-work/0d177465a8151eb6ede1768d51d476c7
+auto turbo(float x) noexcept -> lesty::Color
+{
+  x = std::clamp(x, 0.f, 1.f);
+  const float r =
+      0.13572138f +
+      x * (4.61539260f +
+           x * (-42.66032258f +
+                x * (132.13108234f + x * (-152.94239396f + x * 59.28637943f))));
+  const float g =
+      0.09140261f +
+      x * (2.19418839f +
+           x * (4.84296658f +
+                x * (-14.18503333f + x * (4.27729857f + x * 2.82956604f))));
+  const float b =
+      0.10667330f +
+      x * (12.64194608f +
+           x * (-60.58204836f +
+                x * (110.36276771f + x * (-89.90310912f + x * 27.34824973f))));
+  return lesty::Color{std::clamp(r, 0.f, 1.f), std::clamp(g, 0.f, 1.f),
+                      std::clamp(b, 0.f, 1.f)};
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto false_color_heatmap(const Image& costs) -> Image
+{
+  Image heatmap(costs.width(), costs.height());
+  const auto& data = costs.data();
+  if (data.empty()) {
+    return heatmap;
+  }
+
+  std::vector<float> sorted(data.size());
+  std::transform(data.begin(), data.end(), sorted.begin(),
+                 [](const Color& color) { return color.r; });
+  const auto percentile = sorted.begin() +
+                          static_cast<std::ptrdiff_t>(
+                              static_cast<float>(sorted.size() - 1) *
+                              normalization_percentile);
+  std::nth_element(sorted.begin(), percentile, sorted.end());
+  const float scale = *percentile > 0 ? 1 / *percentile : 0;
+
+  for (std::size_t y = 0; y < costs.height(); ++y) {
+    for (std::size_t x = 0; x < costs.width(); ++x) {
+      heatmap.color_at(x, y) = turbo(costs.color_at(x, y).r * scale);
+    }
+  }
+  return heatmap;
+}
+
+} // namespace lesty
@@ -1,26 +1,99 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-
-#include <ctre.hpp>
+#include <future>
+#include <limits>
+#include <string_view>
+#include <type_traits>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
+#include "binary_io.hpp"
 #include "image.hpp"
-
-#include <beyond/core/utils/panic.hpp>
+#include "parallel.hpp"
+#include "tracing.hpp"
 
 namespace {
 
-float to_gamma(float color)
+using lesty::parallel_for_rows;
+using lesty::read_le;
+using lesty::write_le;
+using byte = unsigned char;
+
+using Thresholds = std::array<float, 256>;
+
+// The output byte for a linear value x is 255.99 * encode(x). Instead of
+// calling pow for every channel, we store the smallest linear value that maps
+// to each byte, which is decode(i / 255.99), and binary search this table.
+template <typename Decode>
+auto make_thresholds(Decode decode) noexcept -> Thresholds
 {
-  return std::pow(color, 1 / 2.2f);
+  Thresholds thresholds{};
+  thresholds[0] = -std::numeric_limits<float>::infinity();
+  for (std::size_t i = 1; i < thresholds.size(); ++i) {
+    thresholds[i] = decode(static_cast<float>(i) / 255.99f);
+  }
+  return thresholds;
 }
 
-using byte = unsigned char;
-byte float_color_to_255(float color)
+// Inverse of (sqrt(x))^(1 / 2.2)
+const auto gamma_thresholds =
+    make_thresholds([](float v) { return std::pow(v, 4.4f); });
+
+const auto srgb_thresholds = make_thresholds([](float v) {
+  return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+});
+
+// Values outside of [0, 1] get clamped
+byte encode_by_thresholds(float color, const Thresholds& thresholds) noexcept
+{
+  std::size_t i = 0;
+  for (std::size_t step = thresholds.size() / 2; step > 0; step /= 2) {
+    i += (color >= thresholds[i + step]) ? step : 0;
+  }
+  return static_cast<byte>(i);
+}
+
+byte linear_color_to_255(float color) noexcept
+{
+  return static_cast<byte>(255.99f * std::clamp(color, 0.f, 1.f));
+}
+
+// Gets the lower case extension of filename including the dot
+auto file_extension(const std::string& filename) -> std::string
+{
+  const auto dot = filename.find_last_of('.');
+  const auto slash = filename.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash)) {
+    return {};
+  }
+
+  auto extension = filename.substr(dot);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension;
+}
+
+void write_string(std::ofstream& file, std::string_view str)
+{
+  file.write(str.data(), static_cast<std::streamsize>(str.size()));
+  file.put('\0');
+}
+
+auto open_binary(const std::string& filename) -> std::ofstream
 {
-  return static_cast<byte>(255.99f * to_gamma(color));
+  std::ofstream file{filename, std::ios::binary};
+  if (!file) {
+    throw lesty::Cannot_write_file{filename.c_str()};
+  }
+  return file;
 }
 
 } // namespace
@@ -32,29 +105,321 @@ Image::Image(size_t width, size_t height)
 {
 }
 
-void Image::saveto(const std::string& filename) const
+auto Image::output_pixel(size_t row, size_t col) const noexcept -> const Color&
+{
+  // Output images start from the top right corner of data_
+  return data_[(height_ - 1 - row) * width_ + (width_ - 1 - col)];
+}
+
+void Image::saveto(const std::string& filename, Transfer transfer) const
 {
-  static constexpr auto png_pattern = ctll::fixed_string{R"(.*\.png$)"};
-  if (ctre::match<png_pattern>(filename)) {
-    std::puts("Output to png file");
+  const auto extension = file_extension(filename);
+  if (extension == ".png") {
+    save_png(filename, transfer);
+  } else if (extension == ".pfm") {
+    save_pfm(filename);
+  } else if (extension == ".exr") {
+    save_exr(filename);
+  } else if (extension == ".raw") {
+    save_raw(filename);
   } else {
-    beyond::panic("Unsupported image extension");
+    throw Unsupported_image_extension{filename.c_str()};
+  }
+}
+
+auto tonemap(const Color& color, Image::Transfer transfer) noexcept -> Color
+{
+  switch (transfer) {
+  case Image::Transfer::gamma:
+  case Image::Transfer::linear:
+  case Image::Transfer::srgb:
+    return color;
+  case Image::Transfer::reinhard:
+    return color / (Color{1, 1, 1} + color);
+  case Image::Transfer::aces: {
+    // Credit: Krzysztof Narkowicz, "ACES Filmic Tone Mapping Curve", 2016
+    const auto numerator = color * (2.51f * color + Color{0.03f, 0.03f, 0.03f});
+    const auto denominator =
+        color * (2.43f * color + Color{0.59f, 0.59f, 0.59f}) +
+        Color{0.14f, 0.14f, 0.14f};
+    return numerator / denominator;
+  }
+  }
+  return color;
+}
+
+auto Image::to_8bit(Transfer transfer) const -> std::vector<std::uint8_t>
+{
+  std::vector<std::uint8_t> buffer(data_.size() * 3);
+  if (buffer.empty()) {
+    return buffer;
+  }
+
+  LESTY_TRACE_SCOPE("convert_to_8bit");
+  const auto* thresholds = transfer == Transfer::gamma ? &gamma_thresholds
+                                                       : &srgb_thresholds;
+  parallel_for_rows(height_, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t row = begin; row < end; ++row) {
+      auto* dst = buffer.data() + row * width_ * 3;
+      if (transfer == Transfer::linear) {
+        for (std::size_t col = 0; col < width_; ++col, dst += 3) {
+          const auto& color = output_pixel(row, col);
+          dst[0] = linear_color_to_255(color.r);
+          dst[1] = linear_color_to_255(color.g);
+          dst[2] = linear_color_to_255(color.b);
+        }
+        continue;
+      }
+      for (std::size_t col = 0; col < width_; ++col, dst += 3) {
+        const auto color = tonemap(output_pixel(row, col), transfer);
+        dst[0] = encode_by_thresholds(color.r, *thresholds);
+        dst[1] = encode_by_thresholds(color.g, *thresholds);
+        dst[2] = encode_by_thresholds(color.b, *thresholds);
+      }
+    }
+  });
+  return buffer;
+}
+
+void Image::save_png(const std::string& filename, Transfer transfer) const
+{
+  const auto buffer = to_8bit(transfer);
+
+  LESTY_TRACE_SCOPE("encode_png");
+  if (stbi_write_png(filename.c_str(), static_cast<int>(width_),
+                     static_cast<int>(height_), 3,
+                     buffer.data(),
+                     static_cast<int>(width_ * 3)) == 0) {
+    throw Cannot_write_file{filename.c_str()};
   }
+}
+
+auto Image::to_png(Transfer transfer) const -> std::vector<std::uint8_t>
+{
+  const auto buffer = to_8bit(transfer);
 
-  std::vector<byte> buffer;
-  buffer.reserve(data_.size() * 3);
-  for (auto i = data_.crbegin(), end = data_.crend(); i != end; ++i) {
-    byte red = float_color_to_255(std::sqrt(i->r));
-    byte green = float_color_to_255(std::sqrt(i->g));
-    byte blue = float_color_to_255(std::sqrt(i->b));
-    // auto color: data_
-    buffer.push_back(red);
-    buffer.push_back(green);
-    buffer.push_back(blue);
+  LESTY_TRACE_SCOPE("encode_png");
+  std::vector<std::uint8_t> png;
+  const auto append = [](void* context, void* data, int size) {
+    auto& output = *static_cast<std::vector<std::uint8_t>*>(context);
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    output.insert(output.end(), bytes, bytes + size);
+  };
+  if (stbi_write_png_to_func(append, &png, static_cast<int>(width_),
+                             static_cast<int>(height_), 3, buffer.data(),
+                             static_cast<int>(width_ * 3)) == 0) {
+    throw Cannot_write_file{"<png in memory>"};
   }
-  stbi_write_png(
-      filename.c_str(), static_cast<int>(width_), static_cast<int>(height_), 3,
-      reinterpret_cast<void*>(buffer.data()), static_cast<int>(width_ * 3));
+  return png;
+}
+
+// Portable float map: a text header followed by little endian RGB floats,
+// from the bottom row to the top row
+void Image::save_pfm(const std::string& filename) const
+{
+  LESTY_TRACE_SCOPE("save_pfm");
+  auto file = open_binary(filename);
+  file << "PF\n" << width_ << ' ' << height_ << "\n-1.0\n";
+  for (std::size_t row = height_; row-- > 0;) {
+    for (std::size_t col = 0; col < width_; ++col) {
+      const auto& color = output_pixel(row, col);
+      write_le(file, color.r);
+      write_le(file, color.g);
+      write_le(file, color.b);
+    }
+  }
+}
+
+// A minimal single part, scanline, uncompressed OpenEXR file with 32-bit
+// float channels
+void Image::save_exr(const std::string& filename) const
+{
+  LESTY_TRACE_SCOPE("save_exr");
+  auto file = open_binary(filename);
+
+  write_le(file, std::uint32_t{20000630}); // Magic number
+  write_le(file, std::uint32_t{2});        // Version 2, single part scanline
+
+  const auto write_attribute_header = [&file](std::string_view name,
+                                              std::string_view type,
+                                              std::uint32_t size) {
+    write_string(file, name);
+    write_string(file, type);
+    write_le(file, size);
+  };
+
+  // Channels need to be sorted by name
+  constexpr std::array channel_names = {"B", "G", "R"};
+  constexpr std::uint32_t float_pixel_type = 2;
+  write_attribute_header("channels", "chlist", 18 * 3 + 1);
+  for (const auto* name : channel_names) {
+    write_string(file, name);
+    write_le(file, float_pixel_type);
+    write_le(file, std::uint32_t{0}); // pLinear and reserved bytes
+    write_le(file, std::int32_t{1});  // x sampling
+    write_le(file, std::int32_t{1});  // y sampling
+  }
+  file.put('\0');
+
+  write_attribute_header("compression", "compression", 1);
+  file.put('\0'); // NO_COMPRESSION
+
+  const auto max_x = static_cast<std::int32_t>(width_) - 1;
+  const auto max_y = static_cast<std::int32_t>(height_) - 1;
+  for (const auto* window : {"dataWindow", "displayWindow"}) {
+    write_attribute_header(window, "box2i", 16);
+    write_le(file, std::int32_t{0});
+    write_le(file, std::int32_t{0});
+    write_le(file, max_x);
+    write_le(file, max_y);
+  }
+
+  write_attribute_header("lineOrder", "lineOrder", 1);
+  file.put('\0'); // INCREASING_Y
+
+  write_attribute_header("pixelAspectRatio", "float", 4);
+  write_le(file, 1.f);
+
+  write_attribute_header("screenWindowCenter", "v2f", 8);
+  write_le(file, 0.f);
+  write_le(file, 0.f);
+
+  write_attribute_header("screenWindowWidth", "float", 4);
+  write_le(file, 1.f);
+
+  file.put('\0'); // End of the header
+
+  // Every scanline is a chunk made of its y coordinate, its data size, and
+  // the planar channel data
+  const auto line_size = static_cast<std::uint32_t>(width_ * 3 * 4);
+  const auto chunk_size = std::uint64_t{line_size} + 8;
+  const auto table_offset = static_cast<std::uint64_t>(file.tellp());
+  const auto first_chunk = table_offset + height_ * sizeof(std::uint64_t);
+  for (std::size_t row = 0; row < height_; ++row) {
+    write_le(file, first_chunk + row * chunk_size);
+  }
+
+  for (std::size_t row = 0; row < height_; ++row) {
+    write_le(file, static_cast<std::int32_t>(row));
+    write_le(file, line_size);
+    for (std::size_t col = 0; col < width_; ++col) {
+      write_le(file, output_pixel(row, col).b);
+    }
+    for (std::size_t col = 0; col < width_; ++col) {
+      write_le(file, output_pixel(row, col).g);
+    }
+    for (std::size_t col = 0; col < width_; ++col) {
+      write_le(file, output_pixel(row, col).r);
+    }
+  }
+}
+
+// The raw format is a 32 bytes header followed by 3 floats per pixel in the
+// row order of Image. Color has a fourth padding lane, which is not stored.
+void Image::save_raw(const std::string& filename) const
+{
+  LESTY_TRACE_SCOPE("save_raw");
+  auto file = open_binary(filename);
+  file.write(raw_image_magic, sizeof(raw_image_magic));
+  write_le(file, raw_image_version);
+  write_le(file, static_cast<std::uint32_t>(width_));
+  write_le(file, static_cast<std::uint32_t>(height_));
+  write_le(file, std::uint32_t{3}); // Channels
+  write_le(file, sample_count_);
+  for (const auto& color : data_) {
+    write_le(file, color.r);
+    write_le(file, color.g);
+    write_le(file, color.b);
+  }
+}
+
+auto Image::load_raw(const std::string& filename) -> Image
+{
+  std::ifstream file{filename, std::ios::binary};
+  if (!file) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+
+  std::array<char, sizeof(raw_image_magic)> magic{};
+  file.read(magic.data(), magic.size());
+  const auto version = read_le<std::uint32_t>(file);
+  const auto width = read_le<std::uint32_t>(file);
+  const auto height = read_le<std::uint32_t>(file);
+  const auto channels = read_le<std::uint32_t>(file);
+  const auto sample_count = read_le<std::uint64_t>(file);
+  if (!file || !std::equal(magic.begin(), magic.end(), raw_image_magic) ||
+      version != raw_image_version || channels != 3) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+
+  Image image(width, height);
+  image.sample_count_ = sample_count;
+  for (auto& color : image.data_) {
+    color.r = read_le<float>(file);
+    color.g = read_le<float>(file);
+    color.b = read_le<float>(file);
+  }
+  if (!file) {
+    throw Cannot_read_file{filename.c_str()};
+  }
+  return image;
+}
+
+auto merge_sample_ranges(std::span<const Image> images) -> Image
+{
+  if (images.empty()) {
+    throw std::invalid_argument{"No image to merge"};
+  }
+
+  const auto width = images.front().width();
+  const auto height = images.front().height();
+  std::uint64_t total_samples = 0;
+  for (const auto& image : images) {
+    if (image.width() != width || image.height() != height) {
+      throw std::invalid_argument{"Cannot merge images of different sizes"};
+    }
+    if (image.sample_count() == 0) {
+      throw std::invalid_argument{
+          "Cannot merge an image without its sample count"};
+    }
+    total_samples += image.sample_count();
+  }
+
+  // Sums in double so that the merge order does not matter in practice
+  Image result(width, height);
+  result.set_sample_count(total_samples);
+  const auto pixel_count = width * height;
+  std::vector<double> sums(pixel_count * 3);
+  for (const auto& image : images) {
+    const auto weight = static_cast<double>(image.sample_count());
+    const auto& data = image.data();
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+      sums[3 * i] += weight * static_cast<double>(data[i].r);
+      sums[3 * i + 1] += weight * static_cast<double>(data[i].g);
+      sums[3 * i + 2] += weight * static_cast<double>(data[i].b);
+    }
+  }
+
+  const auto inv_total = 1.0 / static_cast<double>(total_samples);
+  for (std::size_t y = 0; y < height; ++y) {
+    for (std::size_t x = 0; x < width; ++x) {
+      const auto* sum = &sums[3 * (y * width + x)];
+      result.color_at(x, y) = Color{static_cast<float>(sum[0] * inv_total),
+                                    static_cast<float>(sum[1] * inv_total),
+                                    static_cast<float>(sum[2] * inv_total)};
+    }
+  }
+  return result;
+}
+
+auto save_async(Image image, std::string filename, Image::Transfer transfer)
+    -> std::future<void>
+{
+  return std::async(
+      std::launch::async,
+      [image = std::move(image), filename = std::move(filename), transfer] {
+        image.saveto(filename, transfer);
+      });
 }
 
-} // namespace lesty
\ No newline at end of file
+} // namespace lesty
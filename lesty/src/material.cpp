@@ -1,9 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <optional>
-#include <random>
 
 #include <beyond/core/math/vector.hpp>
 
 #include "material.hpp"
+#include "sampling.hpp"
 
 namespace {
 constexpr beyond::Vec3 reflect(beyond::Vec3 v, beyond::Vec3 n) noexcept
@@ -11,11 +13,10 @@ constexpr beyond::Vec3 reflect(beyond::Vec3 v, beyond::Vec3 n) noexcept
   return v - 2 * dot(v, n) * n;
 }
 
-// Refraction by snell's law
-std::optional<beyond::Vec3> refract(beyond::Vec3 v, beyond::Vec3 n,
+// Refraction by snell's law, v need to be a unit vector
+std::optional<beyond::Vec3> refract(beyond::Vec3 uv, beyond::Vec3 n,
                                     float ni_over_nt) noexcept
 {
-  const auto uv = v / v.length();
   float dt = dot(uv, n);
   float discriminant = 1 - ni_over_nt * ni_over_nt * (1 - dt * dt);
   if (discriminant > 0) {
@@ -24,21 +25,6 @@ std::optional<beyond::Vec3> refract(beyond::Vec3 v, beyond::Vec3 n,
   return std::nullopt;
 }
 
-beyond::Vec3 random_in_unit_sphere()
-{
-  // Credit:
-  // https://math.stackexchange.com/questions/87230/picking-random-points-in-the-volume-of-sphere-with-uniform-probability/87238#87238
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-  thread_local std::uniform_real_distribution<float> uni(-1, 1);
-  thread_local std::normal_distribution<float> normal(0, 1);
-
-  beyond::Vec3 p{normal(gen), normal(gen), normal(gen)};
-  p = normalize(p);
-
-  const auto c = std::cbrt(uni(gen));
-  return p * c;
-}
-
 // Reflectivity by Christophe Schlick
 float schlick(float cosine, float ref_idx)
 {
@@ -51,71 +37,119 @@ float schlick(float cosine, float ref_idx)
 
 namespace lesty {
 
-std::optional<Ray> Lambertian::scatter(const Ray& /*ray_in*/,
-                                       const HitRecord& record) const
+namespace {
+
+// Below this roughness, metals are sampled as perfect mirrors
+constexpr float min_roughness = 1e-3f;
+
+// Fresnel reflectance of conductors by the Schlick approximation, with the
+// albedo as the reflectance at normal incidence
+auto schlick_fresnel(Color f0, float cosine) noexcept -> Color
+{
+  const float weight = std::pow(1 - cosine, 5.f);
+  return Color{f0.r + (1 - f0.r) * weight, f0.g + (1 - f0.g) * weight,
+               f0.b + (1 - f0.b) * weight};
+}
+
+auto sample_lambertian(const Material& material, const HitRecord& record,
+                       Rng& rng) noexcept -> Bsdf_sample
 {
-  const auto target = record.point + record.normal + random_in_unit_sphere();
-  return Ray{record.point, target - record.point};
+  const auto basis = Onb::from_normal(record.normal);
+  const float u1 = rng.uniform_float();
+  const float u2 = rng.uniform_float();
+  const auto local = sample_cosine_hemisphere(u1, u2);
+  // The cosine distribution cancels the cosine term and the 1/pi of the BRDF
+  return {basis.to_world(local), material.color,
+          cosine_hemisphere_pdf(local.z)};
 }
 
-std::optional<Ray> Metal::scatter(const Ray& ray_in,
-                                  const HitRecord& record) const
+// The fuzzness of a metal is the roughness alpha of GGX
+auto sample_metal(const Material& material, const Ray& ray_in,
+                  const HitRecord& record, Rng& rng) noexcept -> Bsdf_sample
 {
-  auto incident_dir = ray_in.direction / ray_in.direction.length();
-  auto reflected = reflect(incident_dir, record.normal) +
-                   fuzzness_ * random_in_unit_sphere();
-  if (dot(reflected, record.normal) <= 0) {
-    return std::nullopt;
+  const float alpha = material.parameter;
+  if (alpha < min_roughness) {
+    if (dot(ray_in.direction, record.normal) >= 0) {
+      return {};
+    }
+    const auto direction = reflect(ray_in.direction, record.normal);
+    return {direction,
+            schlick_fresnel(material.color, dot(direction, record.normal)), 1};
   }
 
-  Ray scattered{record.point, reflected};
-  return scattered;
+  const auto basis = Onb::from_normal(record.normal);
+  const auto wo = basis.to_local(-ray_in.direction);
+  if (wo.z <= 0) {
+    return {};
+  }
+
+  const float u1 = rng.uniform_float();
+  const float u2 = rng.uniform_float();
+  const auto h = sample_ggx_visible_normal(wo, alpha, u1, u2);
+  const float wo_dot_h = dot(wo, h);
+  const auto wi = 2 * wo_dot_h * h - wo;
+  if (wi.z <= 0) {
+    return {};
+  }
+
+  // With visible normal sampling, f * cos / pdf reduces to F * G1(wi)
+  auto weight = schlick_fresnel(material.color, wo_dot_h);
+  weight *= ggx_smith_g1(wi, alpha);
+  const float pdf = ggx_smith_g1(wo, alpha) * ggx_distribution(h, alpha) /
+                    (4 * wo.z);
+  return {normalize(basis.to_world(wi)), weight, pdf};
 }
 
-std::optional<Ray> Dielectric::scatter(const Ray& ray_in,
-                                       const HitRecord& record) const
+auto sample_dielectric(const Material& material, const Ray& ray_in,
+                       const HitRecord& record, Rng& rng) noexcept
+    -> Bsdf_sample
 {
+  const float refractive_index = material.parameter;
+
   beyond::Vec3 out_normal;
   float ni_over_nt;
   float cosine;
   if (dot(ray_in.direction, record.normal) > 0) {
     out_normal = -record.normal;
-    ni_over_nt = refractive_index_;
-    cosine = refractive_index_ * dot(ray_in.direction, record.normal) /
-             ray_in.direction.length();
+    ni_over_nt = refractive_index;
+    cosine = refractive_index * dot(ray_in.direction, record.normal);
   } else {
     out_normal = record.normal;
-    ni_over_nt = 1 / refractive_index_;
-    cosine = -dot(ray_in.direction, record.normal) / ray_in.direction.length();
+    ni_over_nt = 1 / refractive_index;
+    cosine = -dot(ray_in.direction, record.normal);
   }
 
   float reflection_prob = 1;
 
   auto refraction = refract(ray_in.direction, out_normal, ni_over_nt);
   if (refraction) {
-    reflection_prob = schlick(cosine, refractive_index_);
+    reflection_prob = schlick(cosine, refractive_index);
   }
 
-  static std::uniform_real_distribution<float> dis(0, 1);
-  thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-
-  if (dis(gen) < reflection_prob) {
-    auto incident_dir = ray_in.direction / ray_in.direction.length();
-    auto reflection = reflect(incident_dir, record.normal);
-    return Ray(record.point, reflection);
+  // Choosing between the two lobes by the Fresnel term keeps the weight at
+  // the albedo
+  if (rng.uniform_float() < reflection_prob) {
+    return {reflect(ray_in.direction, record.normal), material.color, 1};
   }
-  return Ray(record.point, *refraction);
+  return {*refraction, material.color, 1};
 }
 
-std::optional<Ray> Emission::scatter(const Ray& /*ray_in*/,
-                                     const HitRecord& /*record*/) const
-{
-  return {};
-}
+} // anonymous namespace
 
-Color Emission::emitted() const
+auto sample_bsdf(const Material& material, const Ray& ray_in,
+                 const HitRecord& record, Rng& rng) noexcept -> Bsdf_sample
 {
-  return emit_;
+  switch (material.type) {
+  case Material::Type::lambertian:
+    return sample_lambertian(material, record, rng);
+  case Material::Type::metal:
+    return sample_metal(material, ray_in, record, rng);
+  case Material::Type::dielectric:
+    return sample_dielectric(material, ray_in, record, rng);
+  case Material::Type::emission:
+    return {};
+  }
+  return {};
 }
 
-} // namespace lesty
\ No newline at end of file
+} // namespace lesty
@@ -0,0 +1,36 @@
+#ifndef LESTY_PARALLEL_HPP
+#define LESTY_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace lesty {
+
+// Invokes func(begin_row, end_row) for bands of rows in parallel
+template <typename Func> void parallel_for_rows(std::size_t height, Func func)
+{
+  // Also keeps the bounds of the clamp in order
+  if (height == 0) {
+    return;
+  }
+
+  const std::size_t band_count =
+      std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, height);
+  const std::size_t band_height = (height + band_count - 1) / band_count;
+
+  std::vector<std::future<void>> bands;
+  for (std::size_t begin = 0; begin < height; begin += band_height) {
+    const auto end = std::min(begin + band_height, height);
+    bands.push_back(std::async(std::launch::async, func, begin, end));
+  }
+  for (auto& band : bands) {
+    band.get();
+  }
+}
+
+} // namespace lesty
+
+#endif // LESTY_PARALLEL_HPP
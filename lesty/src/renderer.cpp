@@ -2,84 +2,220 @@
 
 #include "renderer.hpp"
 #include "renderers/path_tracing_renderer.hpp"
+#include "rng.hpp"
 #include "tile.hpp"
+#include "tracing.hpp"
 
 #include "scene.hpp"
 
 #include <beyond/core/utils/assert.hpp>
+#include <algorithm>
 #include <future>
 #include <random>
+#include <stdexcept>
+#include <thread>
 
 namespace lesty {
 
-[[nodiscard]] auto trace(const Scene& scene, const Ray& ray,
-                         size_t depth = 0) noexcept -> Color;
+auto Renderer::tile_descs() const -> std::vector<TileDesc>
+{
+  // Tiles stay on the grid of the whole image, so that a cropped render
+  // splits pixels the same way as a full render
+  const size_t crop_end_x = crop_.start_x + crop_.width;
+  const size_t crop_end_y = crop_.start_y + crop_.height;
+  const size_t first_x = crop_.start_x / tile_size * tile_size;
+  const size_t first_y = crop_.start_y / tile_size * tile_size;
+
+  std::vector<TileDesc> descs;
+  for (size_t y = first_y; y < crop_end_y; y += tile_size) {
+    for (size_t x = first_x; x < crop_end_x; x += tile_size) {
+      const size_t start_x = std::max(x, crop_.start_x);
+      const size_t start_y = std::max(y, crop_.start_y);
+      const size_t end_x = std::min(x + tile_size, crop_end_x);
+      const size_t end_y = std::min(y + tile_size, crop_end_y);
+      assert(start_x < end_x && start_y < end_y);
+      descs.push_back(
+          TileDesc{start_x, start_y, end_x - start_x, end_y - start_y});
+    }
+  }
+
+  if (tile_order_ == Tile_order::center) {
+    // In doubled coordinates to stay in integers
+    const auto center_x = static_cast<double>(2 * crop_.start_x + crop_.width);
+    const auto center_y =
+        static_cast<double>(2 * crop_.start_y + crop_.height);
+    const auto distance = [=](const TileDesc& desc) {
+      const auto dx =
+          static_cast<double>(2 * desc.start_x + desc.width) - center_x;
+      const auto dy =
+          static_cast<double>(2 * desc.start_y + desc.height) - center_y;
+      return dx * dx + dy * dy;
+    };
+    std::ranges::stable_sort(descs, {}, distance);
+  }
+  return descs;
+}
+
+auto Renderer::set_crop(const TileDesc& crop) -> void
+{
+  if (crop.width == 0 || crop.height == 0 ||
+      crop.start_x + crop.width > width_ ||
+      crop.start_y + crop.height > height_) {
+    throw std::invalid_argument{"The crop region is not inside the image"};
+  }
+  crop_ = crop;
+}
+
+auto Renderer::renders_whole_image() const noexcept -> bool
+{
+  return crop_.start_x == 0 && crop_.start_y == 0 && crop_.width == width_ &&
+         crop_.height == height_;
+}
 
-auto Renderer::render(const Scene& scene) -> Image
+auto Renderer::common_sample_count(std::span<const Tile> tiles) const noexcept
+    -> size_t
 {
-  const auto width = width_;
-  const auto height = height_;
+  // Merges weight every pixel by the sample count of the image, so pixels
+  // outside of the crop or of a stopped render must not claim one
+  if (!renders_whole_image()) {
+    return 0;
+  }
+  const auto sample_count = tiles.empty() ? 0 : tiles.front().sample_count();
+  for (const auto& tile : tiles) {
+    if (tile.sample_count() != sample_count) {
+      return 0;
+    }
+  }
+  return sample_count;
+}
 
-  std::vector<std::future<Tile>> results;
+auto Renderer::render(const Scene& scene, std::stop_token stop) -> Image
+{
+  LESTY_TRACE_SCOPE("render");
 
+  const auto descs = tile_descs();
   std::atomic<std::size_t> progress_tick = 0;
-  const std::size_t tile_count = height_ * width_ / tile_size / tile_size + 1;
+  const std::size_t tile_count = descs.size();
   auto tick_progress = [this, &progress_tick, tile_count]() {
     ++progress_tick;
     set_progress(static_cast<size_t>(static_cast<double>(progress_tick.load()) /
                                      static_cast<double>(tile_count) * 100.));
   };
 
-  for (size_t y = 0; y < height_; y += tile_size) {
-    for (size_t x = 0; x < width_; x += tile_size) {
-      const size_t end_x = std::min(x + tile_size, width);
-      const size_t end_y = std::min(y + tile_size, height);
-      assert(x < end_x && y < end_y);
-      TileDesc tile_desc{x, y, end_x - x, end_y - y};
-
-      results.push_back(std::async(std::launch::async,
-                                   [this, tile_desc, &scene, &tick_progress] {
-                                     auto tile = render_tile(tile_desc, scene);
-                                     tick_progress();
-                                     return tile;
-                                   }));
+  // Workers take the tiles in order, so that the ones that come first are
+  // done first. Tiles that are skipped after a stop stay empty.
+  stop_ = std::move(stop);
+  std::vector<Tile> tiles(tile_count);
+  std::atomic<std::size_t> next_tile = 0;
+  const auto work = [&] {
+    while (!stop_requested()) {
+      const auto i = next_tile++;
+      if (i >= tile_count) {
+        break;
+      }
+      tiles[i] = render_tile(descs[i], scene);
+      finish_tile(tiles[i]);
+      tick_progress();
     }
+  };
+
+  const auto worker_count = std::clamp<std::size_t>(
+      std::thread::hardware_concurrency(), 1, std::max(tile_count, size_t{1}));
+  std::vector<std::future<void>> workers;
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.push_back(std::async(std::launch::async, work));
+  }
+  for (auto& worker : workers) {
+    worker.get();
   }
+  stop_ = {};
+
+  Image image(width_, height_);
+  image.set_sample_count(common_sample_count(tiles));
+  costs_ = record_costs_ ? Image(width_, height_) : Image(0, 0);
+  aov_buffers_ = Aov_buffers{aovs_, width_, height_};
+  for (const auto& tile : tiles) {
+    write_tile(tile, image);
+    if (tile.has_costs()) {
+      write_tile_costs(tile, costs_);
+    }
+    if (tile.has_aovs()) {
+      write_tile_aovs(tile, aov_buffers_);
+    }
+  }
+  return image;
+}
 
-  Image image(width, height);
-  for (auto& result : results) {
-    result.wait();
-    const auto tile = result.get();
+auto write_tile(const Tile& tile, Image& image) -> void
+{
+  for (size_t j = 0; j < tile.height(); ++j) {
+    for (size_t i = 0; i < tile.width(); ++i) {
+      image.color_at(tile.start_x() + i, tile.start_y() + j) = tile.at(i, j);
+    }
+  }
+}
 
-    for (size_t j = 0; j < tile.height(); ++j) {
-      for (size_t i = 0; i < tile.width(); ++i) {
-        image.color_at(tile.start_x() + i, tile.start_y() + j) = tile.at(i, j);
+auto write_tile_costs(const Tile& tile, Image& image) -> void
+{
+  assert(tile.has_costs());
+  for (size_t j = 0; j < tile.height(); ++j) {
+    for (size_t i = 0; i < tile.width(); ++i) {
+      const float cost = tile.cost_at(i, j);
+      image.color_at(tile.start_x() + i, tile.start_y() + j) =
+          Color{cost, cost, cost};
+    }
+  }
+}
+
+auto write_tile_aovs(const Tile& tile, Aov_buffers& buffers) -> void
+{
+  const auto& aovs = tile.aovs();
+  assert(aovs.aovs() == buffers.aovs());
+  for (const auto aov : all_aovs) {
+    if (!aovs.aovs().contains(aov)) {
+      continue;
+    }
+    for (size_t channel = 0; channel < channel_count(aov); ++channel) {
+      const auto source = aovs.plane(aov, channel);
+      for (size_t j = 0; j < tile.height(); ++j) {
+        const auto row = source.subspan(j * tile.width(), tile.width());
+        std::ranges::copy(row, &buffers.at(aov, channel, tile.start_x(),
+                                           tile.start_y() + j));
       }
     }
   }
-  return image;
-} // namespace lesty
+}
 
-auto create_renderers(Renderer::Type type, const Options& options)
+auto create_renderers(Renderer::Type type, const Options& options,
+                      const Camera_settings& camera)
     -> std::unique_ptr<Renderer>
 {
-  using namespace beyond::literals;
-
   const auto aspect_ratio =
       static_cast<float>(options.width) / static_cast<float>(options.height);
 
+  std::unique_ptr<Renderer> renderer;
   switch (type) {
   case Renderer::Type::path:
-    return std::make_unique<PathTracingRenderer>(options.width, options.height,
-                                                 options.spp,
-                                                 Camera{{278, 278, -800},
-                                                        {278, 278, 0},
-                                                        {0, 1, 0},
-                                                        40.0_deg,
-                                                        aspect_ratio});
+    renderer = std::make_unique<PathTracingRenderer>(
+        options.width, options.height, options.spp,
+        Camera{camera, aspect_ratio});
+    break;
   default:
     BEYOND_UNREACHABLE();
   }
+  renderer->set_first_sample(options.first_sample);
+  renderer->set_seed(options.seed);
+  renderer->set_record_costs(!options.heatmap_filename.empty());
+  auto aovs = options.aovs;
+  if (options.denoise) {
+    aovs.insert({Aov::normal, Aov::albedo});
+  }
+  renderer->set_aovs(aovs);
+  if (options.crop.width != 0 && options.crop.height != 0) {
+    renderer->set_crop(options.crop);
+  }
+  renderer->set_tile_order(options.tile_order);
+  return renderer;
 }
 
 } // namespace lesty
\ No newline at end of file
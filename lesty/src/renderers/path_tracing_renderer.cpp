@@ -1,70 +1,282 @@
 #include "path_tracing_renderer.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <future>
-#include <random>
 
 #include "camera.hpp"
 #include "color.hpp"
 #include "image.hpp"
 #include "material.hpp"
 #include "ray.hpp"
+#include "rng.hpp"
 #include "scene.hpp"
+#include "stats.hpp"
+#include "tracing.hpp"
 
 namespace lesty {
 
-[[nodiscard]] auto trace(const Scene& scene, const Ray& ray,
+namespace {
+
+// A cone around a path that grows with the distance, its width at a hit point
+// is the footprint of the texture lookup.
+//
+// Credit: Akenine-Moller et al., "Texture Level of Detail Strategies for
+// Real-Time Ray Tracing", Ray Tracing Gems 2019
+struct Ray_cone {
+  float width = 0;  ///< Width at the origin of the ray
+  float spread = 0; ///< Angle at which the width grows
+};
+
+// Spread added by a diffuse bounce, where neighbouring paths diverge
+// completely, so later hits use a coarse mip level
+constexpr float diffuse_spread = 1;
+
+auto scattered_cone(const Material& material, Ray_cone cone) noexcept
+    -> Ray_cone
+{
+  switch (material.type) {
+  case Material::Type::lambertian:
+    cone.spread += diffuse_spread;
+    break;
+  case Material::Type::metal:
+    // The width of a GGX lobe is about its roughness
+    cone.spread += material.parameter;
+    break;
+  case Material::Type::dielectric:
+  case Material::Type::emission:
+    break;
+  }
+  return cone;
+}
+
+// What a camera ray sees first, which is recorded in the AOVs
+struct First_hit {
+  bool is_hit = false;
+  float depth = 0;
+  Color normal;
+  Color albedo;
+  std::uint32_t primitive_index = 0;
+  std::uint32_t material_index = 0;
+};
+
+// Fills first_hit if it is not null
+[[nodiscard]] auto trace(const Scene& scene, const Ray& ray, Ray_cone cone,
+                         Rng& rng, First_hit* first_hit = nullptr,
                          size_t depth = 0) noexcept -> Color
 {
   constexpr size_t max_depth = 100;
 
   // depth exceed some threshold
   if (depth >= max_depth) {
+    LESTY_STAT_INC(path_ends[Render_stats::max_depth]);
     return Color{}; // return black
   }
 
-  if (auto hit = scene.intersect_at(ray)) {
-    auto material = hit->material;
-    auto ref = material->scatter(ray, *hit);
-    const auto emitted = material->emitted();
-    if (ref) {
-      return emitted + material->albedo() * trace(scene, *ref, depth + 1);
+  LESTY_STAT_INC(
+      rays_per_depth[std::min(depth, Render_stats::depth_buckets - 1)]);
+  HitRecord hit;
+  if (scene.intersect_at(ray, hit)) {
+    auto material = scene.material(hit.material_index);
+    cone.width += cone.spread * hit.t;
+    if (material.texture != no_texture) {
+      material.color *= scene.texture(material.texture)
+                            .lookup(hit.uv, cone.width * hit.uv_scale);
+    }
+    if (first_hit != nullptr) {
+      // The radiance of lights is above 1
+      auto albedo = material.color;
+      albedo.clamp();
+      *first_hit = First_hit{true,
+                             hit.t,
+                             Color{hit.normal.x, hit.normal.y, hit.normal.z},
+                             albedo,
+                             hit.primitive_index,
+                             hit.material_index};
+    }
+
+    const auto emission = emitted(material);
+    const auto sample = sample_bsdf(material, ray, hit, rng);
+    if (!sample.is_absorbed()) {
+      const Ray scattered{hit.point, sample.direction, ray.time};
+      return emission +
+             sample.weight * trace(scene, scattered,
+                                   scattered_cone(material, cone), rng,
+                                   nullptr, depth + 1);
     }
-    return emitted;
+    LESTY_STAT_INC(path_ends[Render_stats::absorbed]);
+    return emission;
   }
 
   // Returns black if ray does not hit any object
+  LESTY_STAT_INC(path_ends[Render_stats::escaped]);
   return Color{};
 }
 
+// Adds the first hit of a sample to pixel (i, j) of the AOVs
+auto record_aovs(Aov_buffers& aovs, size_t i, size_t j,
+                 const First_hit& first_hit, bool is_first_sample) noexcept
+    -> void
+{
+  const auto set = aovs.aovs();
+  if (set.contains(Aov::normal)) {
+    aovs.at(Aov::normal, 0, i, j) += first_hit.normal.r;
+    aovs.at(Aov::normal, 1, i, j) += first_hit.normal.g;
+    aovs.at(Aov::normal, 2, i, j) += first_hit.normal.b;
+  }
+  if (set.contains(Aov::albedo)) {
+    aovs.at(Aov::albedo, 0, i, j) += first_hit.albedo.r;
+    aovs.at(Aov::albedo, 1, i, j) += first_hit.albedo.g;
+    aovs.at(Aov::albedo, 2, i, j) += first_hit.albedo.b;
+  }
+  if (!is_first_sample) {
+    return;
+  }
+  if (set.contains(Aov::depth)) {
+    aovs.at(Aov::depth, 0, i, j) = first_hit.depth;
+  }
+  if (set.contains(Aov::primitive_id)) {
+    aovs.at(Aov::primitive_id, 0, i, j) =
+        static_cast<float>(first_hit.primitive_index);
+  }
+  if (set.contains(Aov::material_id)) {
+    aovs.at(Aov::material_id, 0, i, j) =
+        static_cast<float>(first_hit.material_index);
+  }
+}
+
+// Turns the sums of the normals and albedos into averages
+auto average_aovs(Aov_buffers& aovs, size_t spp) noexcept -> void
+{
+  for (const auto aov : {Aov::normal, Aov::albedo}) {
+    if (!aovs.aovs().contains(aov)) {
+      continue;
+    }
+    for (size_t channel = 0; channel < channel_count(aov); ++channel) {
+      for (auto& value : aovs.plane(aov, channel)) {
+        value /= static_cast<float>(spp);
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
 auto PathTracingRenderer::render_tile(const TileDesc& tile_desc,
                                       const Scene& scene) -> Tile
 {
+  LESTY_TRACE_SCOPE("render_tile",
+                    {{"x", tile_desc.start_x}, {"y", tile_desc.start_y}});
+  // Guards the baked geometry once for the whole tile, instead of once per
+  // intersection
+  const Geometry_cache::Read_guard geometry_guard{scene.geometry_cache()};
+
   const auto f_width = static_cast<float>(width());
   const auto f_height = static_cast<float>(height());
   const auto spp = sample_per_pixel();
+  const auto& cam = camera();
+  const bool sample_lens = cam.has_lens();
+  const bool sample_time = cam.has_motion_blur();
+  const Ray_cone pixel_cone{0, cam.pixel_spread_angle(height())};
 
   Tile tile(tile_desc);
+  if (record_costs()) {
+    tile.enable_costs();
+  }
+  if (!aovs().empty()) {
+    tile.enable_aovs(aovs());
+  }
+
+  // Rays are generated a row of the tile at a time
+  std::vector<Camera_sample> samples(tile_desc.width);
+  std::vector<Ray> rays(tile_desc.width);
 
+  // Every sample of every pixel has its own generator, so the result does not
+  // depend on which thread or process renders the tile, and renders of
+  // different sample ranges can be merged
+  std::vector<std::uint64_t> pixel_seeds(tile_desc.width * tile_desc.height);
   for (size_t j = 0; j < tile_desc.height; ++j) {
-    const auto f_y = static_cast<float>(tile_desc.start_y + j);
     for (size_t i = 0; i < tile_desc.width; ++i) {
-      const auto f_x = static_cast<float>(tile_desc.start_x + i);
+      const auto pixel_index =
+          (tile_desc.start_y + j) * width() + tile_desc.start_x + i;
+      pixel_seeds[j * tile_desc.width + i] = mix_seed(seed(), pixel_index);
+    }
+  }
+  std::vector<Rng> rngs(tile_desc.width);
 
-      Color c;
-      thread_local std::mt19937 gen = std::mt19937{std::random_device{}()};
-      std::uniform_real_distribution<float> dis(0.0, 1.0);
-      for (size_t sample = 0; sample < spp; ++sample) {
-        const auto u = (f_x + dis(gen)) / f_width;
-        const auto v = (f_y + dis(gen)) / f_height;
+  // Samples are taken a pass over the whole tile at a time, so that a stopped
+  // render leaves every pixel of the tile with the same number of samples
+  size_t sample_count = 0;
+  for (size_t sample = first_sample();
+       sample < first_sample() + spp && !stop_requested(); ++sample) {
+    const bool is_first_sample = sample == first_sample();
+    for (size_t j = 0; j < tile_desc.height; ++j) {
+      const auto f_y = static_cast<float>(tile_desc.start_y + j);
+      for (size_t i = 0; i < tile_desc.width; ++i) {
+        const auto f_x = static_cast<float>(tile_desc.start_x + i);
+        auto& rng = rngs[i];
+        rng = Rng{mix_seed(pixel_seeds[j * tile_desc.width + i], sample)};
+        auto& camera_sample = samples[i];
+        camera_sample.film_pos = {(f_x + rng.uniform_float()) / f_width,
+                                  (f_y + rng.uniform_float()) / f_height};
+        if (sample_lens) {
+          camera_sample.lens_pos = {rng.uniform_float(), rng.uniform_float()};
+        }
+        if (sample_time) {
+          camera_sample.time = rng.uniform_float();
+        }
+      }
+
+      cam.get_rays(samples, rays);
+      if (tile.has_costs()) {
+        using Clock = std::chrono::steady_clock;
+        for (size_t i = 0; i < tile_desc.width; ++i) {
+          First_hit first_hit;
+          const auto start = Clock::now();
+          tile.at(i, j) += trace(scene, rays[i], pixel_cone, rngs[i],
+                                 tile.has_aovs() ? &first_hit : nullptr);
+          const std::chrono::duration<float> elapsed = Clock::now() - start;
+          tile.cost_at(i, j) += elapsed.count();
+          if (tile.has_aovs() && first_hit.is_hit) {
+            record_aovs(tile.aovs(), i, j, first_hit, is_first_sample);
+          }
+        }
+      } else if (tile.has_aovs()) {
+        for (size_t i = 0; i < tile_desc.width; ++i) {
+          First_hit first_hit;
+          tile.at(i, j) +=
+              trace(scene, rays[i], pixel_cone, rngs[i], &first_hit);
+          if (first_hit.is_hit) {
+            record_aovs(tile.aovs(), i, j, first_hit, is_first_sample);
+          }
+        }
+      } else {
+        for (size_t i = 0; i < tile_desc.width; ++i) {
+          tile.at(i, j) += trace(scene, rays[i], pixel_cone, rngs[i]);
+        }
+      }
+    }
+    ++sample_count;
+  }
 
-        const auto r = camera().get_ray(Camera_sample{{u, v}});
-        c += trace(scene, r);
+  tile.set_sample_count(sample_count);
+  if (sample_count > 0) {
+    for (size_t j = 0; j < tile_desc.height; ++j) {
+      for (size_t i = 0; i < tile_desc.width; ++i) {
+        tile.at(i, j) /= static_cast<float>(sample_count);
       }
-      c /= static_cast<float>(spp);
-      tile.at(i, j) = c;
     }
+    if (tile.has_aovs()) {
+      average_aovs(tile.aovs(), sample_count);
+    }
+  }
+
+  // Merging once per tile keeps the lock out of the inner loops
+  if constexpr (stats_enabled) {
+    flush_thread_stats();
   }
   return tile;
 }
 
-} // namespace lesty
\ No newline at end of file
+} // namespace lesty
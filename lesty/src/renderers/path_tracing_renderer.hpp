@@ -23,7 +23,6 @@ public:
   {
   }
 
-private:
   auto render_tile(const TileDesc& tile_desc, const Scene& scene)
       -> Tile override;
 };
@@ -4,17 +4,22 @@
 
 namespace lesty {
 
-/**
- * @param r The ray to check intersection
- * @return std::nullopt if the ray do not intersect with the sphere,
- * a HitRecord struct if the ray intersects the sphere
- */
+auto Scene::intersect_at(const Ray& r, HitRecord& record) const -> bool
+{
+  return bvh_.intersection_with(r, 0.001f,
+                                std::numeric_limits<float>::infinity(), record);
+}
 
-auto Scene::intersect_at(const Ray& r) const -> std::optional<HitRecord>
+auto Scene::update_bvh(float rebuild_threshold) -> bool
 {
-  assert(aggregate_ != nullptr);
-  return aggregate_->intersection_with(r, 0.001f,
-                                       std::numeric_limits<float>::infinity());
+  bvh_.refit();
+  if (bvh_.sah_cost() <= rebuild_threshold * built_sah_cost_) {
+    return false;
+  }
+
+  bvh_.rebuild();
+  built_sah_cost_ = bvh_.sah_cost();
+  return true;
 }
 
 } // namespace lesty
\ No newline at end of file
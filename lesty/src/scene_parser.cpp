@@ -1,16 +1,135 @@
 #include "scene_parser.hpp"
+
+#include <algorithm>
+#include <iterator>
+
 #include "axis_aligned_rect.hpp"
-#include "bounding_volume_hierarchy.hpp"
+#include "geometry_cache.hpp"
 #include "material.hpp"
 #include "sphere.hpp"
+#include "texture.hpp"
+#include "tracing.hpp"
 #include "triangle.hpp"
 
 #include "nlohmann/json.hpp"
 
+namespace {
+
+// Estimated bytes of a primitive, including its BVH nodes
+constexpr std::size_t bytes_per_object = 128;
+
+auto parse_color(const nlohmann::json& color_json) -> lesty::Color
+{
+  return lesty::Color{color_json.at(0).get<float>(),
+                      color_json.at(1).get<float>(),
+                      color_json.at(2).get<float>()};
+}
+
+auto parse_point2(const nlohmann::json& pt_json) -> beyond::Point2
+{
+  return beyond::Point2{pt_json.at(0).get<float>(),
+                        pt_json.at(1).get<float>()};
+}
+
+auto parse_point3(const nlohmann::json& pt_json) -> beyond::Point3
+{
+  return beyond::Point3{pt_json.at(0).get<float>(),
+                        pt_json.at(1).get<float>(),
+                        pt_json.at(2).get<float>()};
+}
+
+auto parse_vec3(const nlohmann::json& vec_json) -> beyond::Vec3
+{
+  return beyond::Vec3{vec_json.at(0).get<float>(),
+                      vec_json.at(1).get<float>(),
+                      vec_json.at(2).get<float>()};
+}
+
+// Parses the camera settings, missing entries keep their value in settings
+auto parse_camera_settings(const nlohmann::json& camera_json,
+                           lesty::Camera_settings settings)
+    -> lesty::Camera_settings
+{
+  if (camera_json.contains("position")) {
+    settings.position = parse_point3(camera_json["position"]);
+  }
+  if (camera_json.contains("lookat")) {
+    settings.lookat = parse_point3(camera_json["lookat"]);
+  }
+  if (camera_json.contains("up")) {
+    settings.up = parse_vec3(camera_json["up"]);
+  }
+  settings.fov = camera_json.value("fov", settings.fov);
+  settings.aperture = camera_json.value("aperture", settings.aperture);
+  settings.focus_distance =
+      camera_json.value("focus_distance", settings.focus_distance);
+  if (camera_json.contains("shutter")) {
+    const auto& shutter_json = camera_json["shutter"];
+    settings.shutter_open = shutter_json.at(0).get<float>();
+    settings.shutter_close = shutter_json.at(1).get<float>();
+  }
+
+  if (settings.aperture < 0 || settings.focus_distance <= 0) {
+    throw std::runtime_error("Invalid lens of the camera\n");
+  }
+  // Bounding boxes of moving objects only cover the [0, 1] time interval
+  if (settings.shutter_open < 0 || settings.shutter_close > 1 ||
+      settings.shutter_open > settings.shutter_close) {
+    throw std::runtime_error(
+        "The shutter interval need to be within [0, 1]\n");
+  }
+  return settings;
+}
+
+auto parse_camera_path_json(const nlohmann::json& path_json,
+                            const lesty::Camera_settings& base_settings)
+    -> lesty::Camera_path
+{
+  if (!path_json.contains("keyframes") || !path_json["keyframes"].is_array() ||
+      path_json["keyframes"].empty()) {
+    throw std::runtime_error("Missing the keyframes of the camera path\n");
+  }
+
+  std::vector<lesty::Camera_keyframe> keyframes;
+  for (const auto& key_json : path_json["keyframes"]) {
+    // Each keyframe inherits the settings that it does not specify from the
+    // previous one
+    const auto& previous_settings =
+        keyframes.empty() ? base_settings : keyframes.back().settings;
+    const lesty::Camera_keyframe keyframe{
+        key_json.at("time").get<float>(),
+        parse_camera_settings(key_json, previous_settings)};
+
+    if (!keyframes.empty() && keyframe.time <= keyframes.back().time) {
+      throw std::runtime_error(
+          "Keyframes of the camera path need to be sorted by time\n");
+    }
+    keyframes.push_back(keyframe);
+  }
+
+  const auto frame_count = path_json.value("frames", keyframes.size());
+  if (frame_count == 0) {
+    throw std::runtime_error("A camera path needs at least one frame\n");
+  }
+  return lesty::Camera_path{std::move(keyframes), frame_count};
+}
+
+} // anonymous namespace
+
 namespace lesty {
 
-[[nodiscard]] auto parse_scene(std::ifstream& file) -> Scene
+[[nodiscard]] auto parse_scene(std::ifstream& file,
+                               const std::filesystem::path& directory)
+    -> Scene
 {
+  LESTY_TRACE_SCOPE("parse_scene");
+
+  // Scenes render the same wherever lesty is started
+  const auto resolve = [&](const nlohmann::json& path_json) {
+    const std::filesystem::path path{path_json.get<std::string>()};
+    return path.is_relative() ? (directory / path).string() : path.string();
+  };
+
   nlohmann::json json;
   file >> json;
 
@@ -32,47 +151,58 @@ namespace lesty {
   const auto title = json["title"].get<std::string>();
   fmt::print("Title: {}\n", title);
 
-  auto parse_color = [](nlohmann::json color_json) {
-    return lesty::Color{color_json.at(0).get<float>(),
-                        color_json.at(1).get<float>(),
-                        color_json.at(2).get<float>()};
-  };
+  // Everything of the scene is allocated in one arena. The size of the first
+  // block is a guess that fits scenes made of spheres and rects
+  auto arena = std::make_unique<Arena>(std::max(
+      Arena::default_block_size, json["objects"].size() * bytes_per_object));
+
+  // Only the headers of the images are read here, their texels are loaded on
+  // first use
+  std::vector<Arena_ptr<Texture>> textures;
+  if (json.contains("textures")) {
+    for (const auto& texture_json : json["textures"]) {
+      textures.push_back(
+          arena->make<Texture>(resolve(texture_json.at("file"))));
+    }
+  }
 
-  std::vector<std::unique_ptr<Material>> materials;
+  std::vector<Material> materials;
+  materials.reserve(json["materials"].size());
   for (const auto& mat_json : json["materials"]) {
     const auto type = mat_json["type"].get<std::string>();
     if (type == "Lambertian") {
       const auto albedo = parse_color(mat_json["albedo"]);
-      materials.emplace_back(std::make_unique<Lambertian>(albedo));
+      materials.push_back(Material::lambertian(albedo));
     } else if (type == "Emission") {
       const auto albedo = parse_color(mat_json["emit"]);
-      materials.emplace_back(std::make_unique<Emission>(albedo));
+      materials.push_back(Material::emission(albedo));
     } else if (type == "Metal") {
       const auto albedo = parse_color(mat_json["albedo"]);
-      materials.emplace_back(
-          std::make_unique<Metal>(albedo, mat_json["fuzzness"].get<float>()));
+      materials.push_back(
+          Material::metal(albedo, mat_json["fuzzness"].get<float>()));
     } else if (type == "Dialectic") {
       const auto albedo = parse_color(mat_json["albedo"]);
-      materials.emplace_back(std::make_unique<Dielectric>(
+      materials.push_back(Material::dielectric(
           albedo, mat_json["refractive_index"].get<float>()));
     } else {
       throw std::runtime_error(fmt::format("Invalid material type {}\n", type));
     }
-  }
-
-  auto parse_point2 = [](nlohmann::json pt_json) {
-    return beyond::Point2{pt_json.at(0).get<float>(),
-                          pt_json.at(1).get<float>()};
-  };
 
-  auto parse_point3 = [](nlohmann::json pt_json) {
-    return beyond::Point3{pt_json.at(0).get<float>(),
-                          pt_json.at(1).get<float>(),
-                          pt_json.at(2).get<float>()};
-  };
+    if (mat_json.contains("texture")) {
+      const auto texture_id = mat_json["texture"].get<std::size_t>();
+      if (texture_id >= textures.size()) {
+        throw std::runtime_error(
+            fmt::format("Invalid texture index {}, totally {} textures\n",
+                        texture_id, textures.size()));
+      }
+      materials.back().texture = static_cast<std::uint32_t>(texture_id);
+    }
+  }
 
   const auto materials_count = materials.size();
-  std::vector<std::unique_ptr<Hitable>> objects;
+  Arena_ptr<Geometry_cache> geometry_cache;
+  std::vector<Arena_ptr<Hitable>> objects;
+  objects.reserve(json["objects"].size());
   for (const auto& obj_json : json["objects"]) {
     const auto type = obj_json["type"].get<std::string>();
 
@@ -82,7 +212,7 @@ namespace lesty {
           fmt::format("Invalid material index {}, totally {} materials\n",
                       material_id, materials_count));
     }
-    const auto& material = *materials[material_id];
+    const auto material = static_cast<std::uint32_t>(material_id);
 
     if (type.starts_with("Rect")) {
       auto min = parse_point2(obj_json["min"]);
@@ -93,13 +223,13 @@ namespace lesty {
                                   : NormalDirection::Negetive;
 
       if (type == "RectYZ") {
-        objects.emplace_back(std::make_unique<Rect_YZ>(
+        objects.emplace_back(arena->make<Rect_YZ>(
             min, max, obj_json["x"].get<float>(), material, normal_direction));
       } else if (type == "RectXZ") {
-        objects.emplace_back(std::make_unique<Rect_XZ>(
+        objects.emplace_back(arena->make<Rect_XZ>(
             min, max, obj_json["y"].get<float>(), material, normal_direction));
       } else if (type == "RectXY") {
-        objects.emplace_back(std::make_unique<Rect_XY>(
+        objects.emplace_back(arena->make<Rect_XY>(
             min, max, obj_json["z"].get<float>(), material, normal_direction));
       } else {
         throw std::runtime_error(fmt::format("Invalid object type {}\n", type));
@@ -107,20 +237,64 @@ namespace lesty {
     } else if (type == "Sphere") {
       auto center = parse_point3(obj_json["center"]);
 
-      objects.emplace_back(std::make_unique<Sphere>(
-          center, obj_json["radius"].get<float>(), material));
+      auto sphere = arena->make<Sphere>(
+          center, obj_json["radius"].get<float>(), material);
+      if (obj_json.contains("velocity")) {
+        sphere->velocity = parse_vec3(obj_json["velocity"]);
+      }
+      objects.emplace_back(std::move(sphere));
     } else if (type == "Triangle") {
       const auto tri_json = obj_json["points"];
-      objects.emplace_back(std::make_unique<Triangle>(
+      auto triangle = arena->make<Triangle>(
           parse_point3(tri_json.at(0)), parse_point3(tri_json.at(1)),
-          parse_point3(tri_json.at(2)), material));
+          parse_point3(tri_json.at(2)), material);
+      if (obj_json.contains("uvs")) {
+        const auto& uvs_json = obj_json["uvs"];
+        triangle->uvs = {parse_point2(uvs_json.at(0)),
+                         parse_point2(uvs_json.at(1)),
+                         parse_point2(uvs_json.at(2))};
+      }
+      objects.emplace_back(std::move(triangle));
+    } else if (type == "BakedMesh") {
+      // Only the chunk table is read here, chunks are loaded when rays reach
+      // them
+      if (!geometry_cache) {
+        geometry_cache = arena->make<Geometry_cache>();
+      }
+      auto chunks =
+          geometry_cache->open(resolve(obj_json.at("file")), material, *arena);
+      std::move(chunks.begin(), chunks.end(), std::back_inserter(objects));
     } else {
       throw std::runtime_error(fmt::format("Invalid object type {}\n", type));
     }
   }
 
-  return Scene(std::make_unique<BVH_node>(objects.begin(), objects.end()),
-               std::move(materials));
+  Scene scene(std::move(arena), std::move(objects), materials,
+              std::move(textures), std::move(geometry_cache));
+  if (json.contains("camera")) {
+    scene.set_camera(parse_camera_settings(json["camera"], Camera_settings{}));
+  }
+  if (json.contains("camera_path")) {
+    scene.set_camera_path(
+        parse_camera_path_json(json["camera_path"], scene.camera()));
+  }
+  return scene;
+}
+
+[[nodiscard]] auto parse_camera_path(std::ifstream& file,
+                                     const Camera_settings& base_settings)
+    -> Camera_path
+{
+  nlohmann::json json;
+  file >> json;
+  return parse_camera_path_json(json, base_settings);
+}
+
+auto parse_camera_update(std::string_view json,
+                         const Camera_settings& base_settings)
+    -> Camera_settings
+{
+  return parse_camera_settings(nlohmann::json::parse(json), base_settings);
 }
 
-} // namespace lesty
\ No newline at end of file
+} // namespace lesty
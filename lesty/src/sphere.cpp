@@ -1,51 +1,67 @@
+#include <algorithm>
 #include <cmath>
-#include <utility>
+#include <numbers>
 
 #include "ray.hpp"
 #include "sphere.hpp"
+#include "stats.hpp"
 
 namespace lesty {
 
 auto Sphere::bounding_box() const -> AABB
 {
   const beyond::Vec3 offset(radius, radius, radius);
-  return AABB{center - offset, center + offset, AABB::unchecked_tag};
+  const AABB start{center - offset, center + offset, AABB::unchecked_tag};
+  const auto end_center = center_at(1);
+  const AABB end{end_center - offset, end_center + offset,
+                 AABB::unchecked_tag};
+  return aabb_union(start, end);
 }
 
-auto Sphere::intersection_with(const Ray& r, float t_min, float t_max) const
-    -> std::optional<HitRecord>
+auto Sphere::intersection_with(const Ray& r, float t_min, float t_max,
+                               HitRecord& record) const -> bool
 {
-  const auto oc = r.origin - center;
+  LESTY_STAT_INC(primitive_tests[Render_stats::sphere]);
+  const auto current_center = center_at(r.time);
+  const auto oc = r.origin - current_center;
 
-  const auto a = dot(r.direction, r.direction);
-  const auto b = 2 * dot(r.direction, oc);
+  // With a unit direction, the quadratic coefficient a is 1, and the
+  // equation simplifies to t^2 + 2 * half_b * t + c = 0
+  const auto half_b = dot(r.direction, oc);
   const auto c = dot(oc, oc) - radius * radius;
-  const auto discrimination = b * b - 4 * a * c;
+  const auto discrimination = half_b * half_b - c;
 
   if (discrimination < 0) {
-    return std::nullopt;
+    return false;
   }
 
   const auto sqrt_delta = std::sqrt(discrimination);
-  const auto t1 = (-b - sqrt_delta) / (2 * a);
-  const auto t2 = (-b + sqrt_delta) / (2 * a);
-
-  auto hit_record_from_t = [&r, this](float t) {
-    const auto point = r(t);
-    const auto normal = (point - center) / radius;
-
-    HitRecord record{t, point, normal, material};
-    return std::optional<HitRecord>{std::in_place, record};
-  };
+  const auto t1 = -half_b - sqrt_delta;
+  const auto t2 = -half_b + sqrt_delta;
 
   // Get the smaller non-negative value of t1, t2
+  float t = 0;
   if (t1 >= t_min && t1 < t_max) {
-    return hit_record_from_t(t1);
-  }
-  if (t2 >= t_min && t2 < t_max) {
-    return hit_record_from_t(t2);
+    t = t1;
+  } else if (t2 >= t_min && t2 < t_max) {
+    t = t2;
+  } else {
+    return false;
   }
-  return std::nullopt;
+
+  record.t = t;
+  record.point = r(t);
+  record.normal = (record.point - current_center) / radius;
+  record.material_index = material_index;
+
+  // Longitude and latitude, with the poles on the y axis
+  constexpr float pi = std::numbers::pi_v<float>;
+  const auto& n = record.normal;
+  record.uv = {0.5f + std::atan2(n.z, -n.x) / (2 * pi),
+               0.5f + std::asin(std::clamp(n.y, -1.f, 1.f)) / pi};
+  // The square root of the uv area per surface area
+  record.uv_scale = 1 / (2 * radius * std::sqrt(pi));
+  return true;
 }
 
 } // namespace lesty
\ No newline at end of file
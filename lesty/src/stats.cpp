@@ -0,0 +1,104 @@
+#include "stats.hpp"
+
+#include <mutex>
+
+#include "nlohmann/json.hpp"
+
+namespace {
+
+std::mutex global_stats_mutex;
+lesty::Render_stats global_stats_total;
+
+template <typename Array>
+auto add_arrays(Array& lhs, const Array& rhs) noexcept -> void
+{
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    lhs[i] += rhs[i];
+  }
+}
+
+// Avoids dividing by zero for empty renders
+auto ratio(std::uint64_t numerator, std::uint64_t denominator) -> double
+{
+  return denominator == 0 ? 0.0
+                          : static_cast<double>(numerator) /
+                                static_cast<double>(denominator);
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto Render_stats::operator+=(const Render_stats& rhs) noexcept
+    -> Render_stats&
+{
+  add_arrays(rays_per_depth, rhs.rays_per_depth);
+  bvh_node_visits += rhs.bvh_node_visits;
+  add_arrays(primitive_tests, rhs.primitive_tests);
+  add_arrays(path_ends, rhs.path_ends);
+  return *this;
+}
+
+auto Render_stats::total_rays() const noexcept -> std::uint64_t
+{
+  std::uint64_t total = 0;
+  for (const auto rays : rays_per_depth) {
+    total += rays;
+  }
+  return total;
+}
+
+auto flush_thread_stats() -> void
+{
+  auto& stats = thread_stats();
+  {
+    std::scoped_lock lock{global_stats_mutex};
+    global_stats_total += stats;
+  }
+  stats = Render_stats{};
+}
+
+auto global_stats() -> Render_stats
+{
+  std::scoped_lock lock{global_stats_mutex};
+  return global_stats_total;
+}
+
+auto reset_global_stats() -> void
+{
+  std::scoped_lock lock{global_stats_mutex};
+  global_stats_total = Render_stats{};
+}
+
+auto stats_to_json(const Render_stats& stats,
+                   std::chrono::duration<double> elapsed_time) -> std::string
+{
+  const auto rays = stats.total_rays();
+  std::uint64_t primitive_tests = 0;
+  for (const auto tests : stats.primitive_tests) {
+    primitive_tests += tests;
+  }
+
+  nlohmann::json json;
+  json["elapsed_seconds"] = elapsed_time.count();
+  json["rays"] = rays;
+  json["rays_per_second"] =
+      elapsed_time.count() > 0
+          ? static_cast<double>(rays) / elapsed_time.count()
+          : 0.0;
+  json["rays_per_depth"] = stats.rays_per_depth;
+  json["bvh_node_visits"] = stats.bvh_node_visits;
+  json["bvh_node_visits_per_ray"] = ratio(stats.bvh_node_visits, rays);
+  json["primitive_tests"] = {
+      {"sphere", stats.primitive_tests[Render_stats::sphere]},
+      {"triangle", stats.primitive_tests[Render_stats::triangle]},
+      {"rect", stats.primitive_tests[Render_stats::rect]}};
+  json["primitive_tests_per_ray"] = ratio(primitive_tests, rays);
+  json["path_ends"] = {
+      {"escaped", stats.path_ends[Render_stats::escaped]},
+      {"absorbed", stats.path_ends[Render_stats::absorbed]},
+      {"max_depth", stats.path_ends[Render_stats::max_depth]}};
+  return json.dump(2);
+}
+
+} // namespace lesty
@@ -0,0 +1,353 @@
+#include "texture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <exception>
+#include <memory>
+
+#include <fmt/format.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "image.hpp"
+#include "tracing.hpp"
+
+namespace {
+
+using lesty::Color;
+
+constexpr std::size_t texels_per_tile =
+    lesty::Texture::tile_size * lesty::Texture::tile_size;
+
+auto make_srgb_table() noexcept -> std::array<float, 256>
+{
+  std::array<float, 256> table{};
+  for (std::size_t i = 0; i < table.size(); ++i) {
+    const float c = static_cast<float>(i) / 255.f;
+    table[i] =
+        c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+  }
+  return table;
+}
+
+const auto srgb_table = make_srgb_table();
+
+auto linear_to_srgb8(float value) noexcept -> std::uint32_t
+{
+  const float c = std::clamp(value, 0.f, 1.f);
+  const float encoded =
+      c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1 / 2.4f) - 0.055f;
+  return static_cast<std::uint32_t>(encoded * 255.f + 0.5f);
+}
+
+auto encode_srgb8(const Color& color) noexcept -> std::uint32_t
+{
+  return linear_to_srgb8(color.r) | (linear_to_srgb8(color.g) << 8u) |
+         (linear_to_srgb8(color.b) << 16u);
+}
+
+auto decode_srgb8(std::uint32_t texel) noexcept -> Color
+{
+  return Color{srgb_table[texel & 0xffu], srgb_table[(texel >> 8u) & 0xffu],
+               srgb_table[(texel >> 16u) & 0xffu]};
+}
+
+auto level_size(std::size_t size, std::size_t level) noexcept -> std::size_t
+{
+  return std::max<std::size_t>(size >> level, 1);
+}
+
+auto tile_count(std::size_t size) noexcept -> std::size_t
+{
+  return (size + lesty::Texture::tile_size - 1) / lesty::Texture::tile_size;
+}
+
+auto lerp(const Color& a, const Color& b, float t) noexcept -> Color
+{
+  return a * (1 - t) + b * t;
+}
+
+// Halves an image with a box filter, odd edges reuse their last texel
+auto downsample(std::span<const Color> pixels, std::size_t width,
+                std::size_t height) -> std::vector<Color>
+{
+  const auto new_width = std::max<std::size_t>(width / 2, 1);
+  const auto new_height = std::max<std::size_t>(height / 2, 1);
+  std::vector<Color> result(new_width * new_height);
+  for (std::size_t y = 0; y < new_height; ++y) {
+    const auto y0 = std::min(2 * y, height - 1);
+    const auto y1 = std::min(2 * y + 1, height - 1);
+    for (std::size_t x = 0; x < new_width; ++x) {
+      const auto x0 = std::min(2 * x, width - 1);
+      const auto x1 = std::min(2 * x + 1, width - 1);
+      auto sum = pixels[y0 * width + x0] + pixels[y0 * width + x1] +
+                 pixels[y1 * width + x0] + pixels[y1 * width + x1];
+      sum /= 4;
+      result[y * new_width + x] = sum;
+    }
+  }
+  return result;
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto srgb8_to_linear(std::uint8_t value) noexcept -> float
+{
+  return srgb_table[value];
+}
+
+auto Texture::Level::index(std::size_t x, std::size_t y) const noexcept
+    -> std::size_t
+{
+  const auto tile = (y / tile_size) * tiles_x + x / tile_size;
+  return tile * texels_per_tile + (y % tile_size) * tile_size + x % tile_size;
+}
+
+Texture::Texture(std::size_t width, std::size_t height,
+                 std::span<const Color> pixels, Format format)
+    : width_{width}, height_{height}, format_{format}
+{
+  assert(pixels.size() == width * height);
+  std::call_once(loaded_, [&] { build_levels(pixels, width, height, 0); });
+}
+
+Texture::Texture(std::string filename) : filename_{std::move(filename)}
+{
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  if (!stbi_info(filename_.c_str(), &width, &height, &channels) ||
+      width <= 0 || height <= 0) {
+    throw Cannot_read_file{filename_.c_str()};
+  }
+  width_ = static_cast<std::size_t>(width);
+  height_ = static_cast<std::size_t>(height);
+  format_ = stbi_is_hdr(filename_.c_str()) ? Format::linear_float
+                                           : Format::srgb8;
+}
+
+auto Texture::level_count() const noexcept -> std::size_t
+{
+  std::size_t count = 1;
+  for (auto size = std::max(width_, height_); size > 1; size /= 2) {
+    ++count;
+  }
+  return count;
+}
+
+auto Texture::set_first_level(std::size_t level) noexcept -> void
+{
+  first_level_ = std::min(level, level_count() - 1);
+}
+
+auto Texture::memory_size() const noexcept -> std::size_t
+{
+  const std::size_t texel_size =
+      format_ == Format::srgb8 ? sizeof(std::uint32_t) : sizeof(Color);
+  std::size_t size = 0;
+  for (auto level = first_level_; level < level_count(); ++level) {
+    size += tile_count(level_size(width_, level)) *
+            tile_count(level_size(height_, level)) * texels_per_tile *
+            texel_size;
+  }
+  return size;
+}
+
+auto Texture::load() const -> void
+{
+  LESTY_TRACE_SCOPE("load_texture");
+
+  // Rendering goes on with an obviously wrong color rather than failing in
+  // the middle of a render. Lookups are made from noexcept code, so running
+  // out of memory for a large image must not escape either.
+  try {
+    if (load_levels()) {
+      return;
+    }
+    fmt::print(stderr, "Warning: cannot load texture {}\n", filename_);
+  } catch (const std::exception& e) {
+    fmt::print(stderr, "Warning: cannot load texture {}: {}\n", filename_,
+               e.what());
+  }
+  const Color magenta{1, 0, 1};
+  build_levels({&magenta, 1}, 1, 1, 0);
+}
+
+auto Texture::load_levels() const -> bool
+{
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<Color> pixels;
+  if (format_ == Format::linear_float) {
+    const std::unique_ptr<float, decltype(&stbi_image_free)> data{
+        stbi_loadf(filename_.c_str(), &width, &height, &channels, 3),
+        &stbi_image_free};
+    if (data) {
+      pixels.resize(width_ * height_);
+      for (std::size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = Color{data.get()[3 * i], data.get()[3 * i + 1],
+                          data.get()[3 * i + 2]};
+      }
+    }
+  } else {
+    const std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> data{
+        stbi_load(filename_.c_str(), &width, &height, &channels, 3),
+        &stbi_image_free};
+    if (data) {
+      pixels.resize(width_ * height_);
+      for (std::size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = Color{srgb_table[data.get()[3 * i]],
+                          srgb_table[data.get()[3 * i + 1]],
+                          srgb_table[data.get()[3 * i + 2]]};
+      }
+    }
+  }
+
+  if (pixels.empty() || static_cast<std::size_t>(width) != width_ ||
+      static_cast<std::size_t>(height) != height_) {
+    return false;
+  }
+  build_levels(pixels, width_, height_, first_level_);
+  return true;
+}
+
+auto Texture::build_levels(std::span<const Color> pixels, std::size_t width,
+                           std::size_t height, std::size_t first_level) const
+    -> void
+{
+  levels_.clear();
+  std::vector<Color> current(pixels.begin(), pixels.end());
+  for (std::size_t level = 0;; ++level) {
+    if (level >= first_level) {
+      auto& result = levels_.emplace_back();
+      result.width = width;
+      result.height = height;
+      result.tiles_x = tile_count(width);
+      const auto size = result.tiles_x * tile_count(height) * texels_per_tile;
+      if (format_ == Format::srgb8) {
+        result.srgb_texels.resize(size);
+      } else {
+        result.linear_texels.resize(size);
+      }
+      for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+          const auto& pixel = current[y * width + x];
+          if (format_ == Format::srgb8) {
+            result.srgb_texels[result.index(x, y)] = encode_srgb8(pixel);
+          } else {
+            result.linear_texels[result.index(x, y)] = pixel;
+          }
+        }
+      }
+    }
+
+    if (width == 1 && height == 1) {
+      return;
+    }
+    current = downsample(current, width, height);
+    width = std::max<std::size_t>(width / 2, 1);
+    height = std::max<std::size_t>(height / 2, 1);
+  }
+}
+
+auto Texture::texel(const Level& level, std::ptrdiff_t x,
+                    std::ptrdiff_t y) const noexcept -> Color
+{
+  const auto width = static_cast<std::ptrdiff_t>(level.width);
+  const auto height = static_cast<std::ptrdiff_t>(level.height);
+  // Wraps around, also for negative coordinates
+  const auto wrapped_x = (x % width + width) % width;
+  const auto wrapped_y = (y % height + height) % height;
+  const auto index = level.index(static_cast<std::size_t>(wrapped_x),
+                                 static_cast<std::size_t>(wrapped_y));
+  return format_ == Format::srgb8 ? decode_srgb8(level.srgb_texels[index])
+                                  : level.linear_texels[index];
+}
+
+auto Texture::bilinear(std::size_t level_index, beyond::Point2 uv) const
+    noexcept -> Color
+{
+  const auto& level = levels_[level_index];
+  // Texel centers are at half integers, and images store the top row first
+  const float x = uv.x * static_cast<float>(level.width) - 0.5f;
+  const float y = (1 - uv.y) * static_cast<float>(level.height) - 0.5f;
+  const float x0 = std::floor(x);
+  const float y0 = std::floor(y);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const auto ix = static_cast<std::ptrdiff_t>(x0);
+  const auto iy = static_cast<std::ptrdiff_t>(y0);
+
+  const auto top = lerp(texel(level, ix, iy), texel(level, ix + 1, iy), fx);
+  const auto bottom =
+      lerp(texel(level, ix, iy + 1), texel(level, ix + 1, iy + 1), fx);
+  return lerp(top, bottom, fy);
+}
+
+auto Texture::lookup(beyond::Point2 uv, float footprint) const -> Color
+{
+  std::call_once(loaded_, [this] { load(); });
+
+  // Coordinates far outside of [0, 1) lose precision, and would overflow the
+  // texel indices
+  uv.x -= std::floor(uv.x);
+  uv.y -= std::floor(uv.y);
+
+  const float texels =
+      footprint * static_cast<float>(std::max(width_, height_));
+  const float max_level = static_cast<float>(levels_.size() - 1);
+  const float lod = std::clamp(
+      (texels > 1 ? std::log2(texels) : 0) - static_cast<float>(first_level_),
+      0.f, max_level);
+
+  const auto level = static_cast<std::size_t>(lod);
+  const float t = lod - static_cast<float>(level);
+  const auto color = bilinear(level, uv);
+  if (t <= 0 || level + 1 >= levels_.size()) {
+    return color;
+  }
+  return lerp(color, bilinear(level + 1, uv), t);
+}
+
+auto fit_memory_budget(std::span<const Arena_ptr<Texture>> textures,
+                       std::size_t budget) -> void
+{
+  std::size_t total = 0;
+  for (const auto& texture : textures) {
+    texture->set_first_level(0);
+    total += texture->memory_size();
+  }
+
+  while (total > budget) {
+    // The texture whose finest kept level is the largest
+    Texture* largest = nullptr;
+    std::size_t largest_size = 0;
+    for (const auto& texture : textures) {
+      const auto level = texture->first_level();
+      if (level + 1 >= texture->level_count()) {
+        continue;
+      }
+      const auto size = level_size(texture->width(), level) *
+                        level_size(texture->height(), level);
+      if (size > largest_size) {
+        largest = texture.get();
+        largest_size = size;
+      }
+    }
+    if (largest == nullptr) {
+      return; // Only the 1x1 levels are left
+    }
+
+    total -= largest->memory_size();
+    largest->set_first_level(largest->first_level() + 1);
+    total += largest->memory_size();
+  }
+}
+
+} // namespace lesty
@@ -0,0 +1,128 @@
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "image.hpp"
+
+#include "nlohmann/json.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Trace_event {
+  const char* name;
+  std::array<lesty::Trace_arg, lesty::max_trace_args> args;
+  std::size_t arg_count;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+// Events of one thread. Buffers outlive their threads, because the tiles are
+// rendered by short lived std::async threads.
+struct Thread_buffer {
+  std::uint32_t thread_id = 0;
+  std::mutex mutex; // Only contended while the trace is being written
+  std::vector<Trace_event> events;
+};
+
+std::atomic<bool> is_recording = false;
+Clock::time_point trace_start;
+
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<Thread_buffer>> buffers;
+
+auto thread_buffer() -> Thread_buffer&
+{
+  thread_local Thread_buffer* buffer = [] {
+    std::scoped_lock lock{buffers_mutex};
+    auto& result = buffers.emplace_back(std::make_unique<Thread_buffer>());
+    result->thread_id = static_cast<std::uint32_t>(buffers.size());
+    return result.get();
+  }();
+  return *buffer;
+}
+
+} // anonymous namespace
+
+namespace lesty {
+
+auto start_tracing() -> void
+{
+  {
+    std::scoped_lock lock{buffers_mutex};
+    for (auto& buffer : buffers) {
+      std::scoped_lock buffer_lock{buffer->mutex};
+      buffer->events.clear();
+    }
+    trace_start = Clock::now();
+  }
+  is_recording = true;
+}
+
+auto write_trace(const std::string& filename) -> void
+{
+  is_recording = false;
+
+  const auto microseconds = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+
+  auto events = nlohmann::json::array();
+  {
+    std::scoped_lock lock{buffers_mutex};
+    for (auto& buffer : buffers) {
+      std::scoped_lock buffer_lock{buffer->mutex};
+      for (const auto& event : buffer->events) {
+        nlohmann::json json = {{"name", event.name},
+                               {"ph", "X"},
+                               {"pid", 1},
+                               {"tid", buffer->thread_id},
+                               {"ts", microseconds(event.start - trace_start)},
+                               {"dur", microseconds(event.end - event.start)}};
+        for (std::size_t i = 0; i < event.arg_count; ++i) {
+          json["args"][event.args[i].name] = event.args[i].value;
+        }
+        events.push_back(std::move(json));
+      }
+    }
+  }
+
+  std::ofstream file{filename};
+  if (!file) {
+    throw Cannot_write_file{filename.c_str()};
+  }
+  file << nlohmann::json{{"traceEvents", std::move(events)},
+                         {"displayTimeUnit", "ms"}};
+}
+
+Trace_scope::Trace_scope(const char* name,
+                         std::initializer_list<Trace_arg> args) noexcept
+    : name_{name}, active_{is_recording.load(std::memory_order_relaxed)}
+{
+  if (active_) {
+    assert(args.size() <= max_trace_args);
+    arg_count_ = std::min(args.size(), max_trace_args);
+    std::copy_n(args.begin(), arg_count_, args_.begin());
+    start_ = Clock::now();
+  }
+}
+
+Trace_scope::~Trace_scope()
+{
+  if (!active_) {
+    return;
+  }
+  const auto end = Clock::now();
+  auto& buffer = thread_buffer();
+  std::scoped_lock lock{buffer.mutex};
+  buffer.events.push_back(Trace_event{name_, args_, arg_count_, start_, end});
+}
+
+} // namespace lesty
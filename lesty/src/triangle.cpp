@@ -1,11 +1,15 @@
+#include <cmath>
+
 #include "triangle.hpp"
+#include "stats.hpp"
 
 namespace lesty {
 
 [[nodiscard]] auto Triangle::intersection_with(const Ray& r, float t_min,
-                                               float t_max) const
-    -> std::optional<HitRecord>
+                                               float t_max,
+                                               HitRecord& record) const -> bool
 {
+  LESTY_STAT_INC(primitive_tests[Render_stats::triangle]);
 
   const auto vd = r.direction;
   const auto ve = r.origin;
@@ -38,20 +42,33 @@ namespace lesty {
   // compute t
   const auto t = -(f * ak_jb + e * jc_al + d * bl_kc) / M;
   if ((t < t_min) || (t > t_max))
-    return {};
+    return false;
 
   // compute gamma
   const auto gamma = (i * ak_jb + h * jc_al + g * bl_kc) / M;
   if ((gamma < 0) || (gamma > 1))
-    return {};
+    return false;
 
   // compute beta
   const auto beta = (j * ei_hf + k * gf_di + l * dh_eg) / M;
   if ((beta < 0) || (beta > (1 - gamma)))
-    return {};
+    return false;
+
+  record.t = t;
+  record.point = r(t);
+  record.normal = normal();
+  record.material_index = material_index;
 
-  const auto n = normal();
-  return HitRecord{t, r(t), n, material};
+  const auto alpha = 1 - beta - gamma;
+  record.uv = {alpha * uvs[0].x + beta * uvs[1].x + gamma * uvs[2].x,
+               alpha * uvs[0].y + beta * uvs[1].y + gamma * uvs[2].y};
+  // Both areas are doubled, which cancels out
+  const auto uv_area =
+      std::abs((uvs[1].x - uvs[0].x) * (uvs[2].y - uvs[0].y) -
+               (uvs[1].y - uvs[0].y) * (uvs[2].x - uvs[0].x));
+  const auto area = cross(vb - va, vc - va).length();
+  record.uv_scale = area > 0 ? std::sqrt(uv_area / area) : 0;
+  return true;
 }
 
 [[nodiscard]] auto Triangle::bounding_box() const -> AABB
@@ -0,0 +1,49 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include "aov.hpp"
+
+using lesty::Aov;
+using lesty::Aov_buffers;
+
+TEST_CASE("AOV names", "[aov]")
+{
+  for (const auto aov : lesty::all_aovs) {
+    REQUIRE(lesty::parse_aov(lesty::aov_name(aov)) == aov);
+  }
+  REQUIRE_FALSE(lesty::parse_aov("beauty"));
+}
+
+TEST_CASE("AOV buffers", "[aov]")
+{
+  const Aov_buffers buffers{{Aov::depth, Aov::albedo, Aov::material_id}, 4,
+                            3};
+  REQUIRE(buffers.aovs().contains(Aov::albedo));
+  REQUIRE_FALSE(buffers.aovs().contains(Aov::normal));
+
+  SECTION("Every channel has its own plane")
+  {
+    Aov_buffers copy = buffers;
+    copy.at(Aov::albedo, 1, 2, 1) = 0.5f;
+    REQUIRE(copy.plane(Aov::albedo, 1)[1 * 4 + 2] == 0.5f);
+    REQUIRE(copy.plane(Aov::albedo, 0)[1 * 4 + 2] == 0);
+    REQUIRE(copy.plane(Aov::albedo, 2)[1 * 4 + 2] == 0);
+    REQUIRE(copy.plane(Aov::depth, 0).size() == 12);
+  }
+
+  SECTION("Planes start with the values of misses")
+  {
+    REQUIRE(std::isinf(buffers.at(Aov::depth, 0, 3, 2)));
+    REQUIRE(buffers.at(Aov::material_id, 0, 0, 0) == -1);
+    REQUIRE(buffers.at(Aov::albedo, 2, 1, 1) == 0);
+  }
+
+  SECTION("Single channel AOVs fill all channels of images")
+  {
+    Aov_buffers copy = buffers;
+    copy.at(Aov::material_id, 0, 1, 2) = 7;
+    const auto image = copy.to_image(Aov::material_id);
+    REQUIRE(image.color_at(1, 2) == lesty::Color{7, 7, 7});
+  }
+}
@@ -0,0 +1,47 @@
+#include <catch2/catch.hpp>
+
+#include "arena.hpp"
+
+using lesty::Arena;
+using lesty::Arena_ptr;
+
+namespace {
+
+struct Base {
+  virtual ~Base() = default;
+};
+
+struct Counted : Base {
+  explicit Counted(int& destroyed) : destroyed_{destroyed} {}
+  ~Counted() override
+  {
+    ++destroyed_;
+  }
+
+  int& destroyed_;
+};
+
+} // anonymous namespace
+
+TEST_CASE("Arena allocation", "[arena]")
+{
+  Arena arena;
+
+  SECTION("Objects allocated after each other are contiguous")
+  {
+    const auto first = arena.make<double>(1.0);
+    const auto second = arena.make<double>(2.0);
+    REQUIRE(*first == 1.0);
+    REQUIRE(*second == 2.0);
+    REQUIRE(second.get() == first.get() + 1);
+  }
+
+  SECTION("Objects are destroyed through a pointer to their base")
+  {
+    int destroyed = 0;
+    {
+      Arena_ptr<Base> object = arena.make<Counted>(destroyed);
+    }
+    REQUIRE(destroyed == 1);
+  }
+}
@@ -0,0 +1,114 @@
+#include <catch2/catch.hpp>
+
+#include "bounding_volume_hierarchy.hpp"
+#include "sphere.hpp"
+
+using lesty::AABB;
+using lesty::Arena;
+using lesty::Arena_ptr;
+using lesty::BVH;
+using lesty::Hitable;
+using lesty::HitRecord;
+using lesty::Ray;
+using lesty::Sphere;
+
+static constexpr std::uint32_t dummy_mat = 0;
+static constexpr float inf = std::numeric_limits<float>::infinity();
+
+namespace {
+
+auto make_spheres(Arena& arena, std::size_t count)
+    -> std::vector<Arena_ptr<Hitable>>
+{
+  std::vector<Arena_ptr<Hitable>> objects;
+  for (std::size_t i = 0; i < count; ++i) {
+    objects.push_back(arena.make<Sphere>(
+        beyond::Point3{static_cast<float>(i) * 3, 0, 0}, 1, dummy_mat));
+  }
+  return objects;
+}
+
+} // anonymous namespace
+
+TEST_CASE("BVH construction", "[BVH]")
+{
+  SECTION("An empty BVH never get hit")
+  {
+    const BVH bvh{{}};
+    REQUIRE(bvh.nodes().empty());
+    HitRecord record;
+    REQUIRE_FALSE(
+        bvh.intersection_with(Ray{{0, 0, 0}, {1, 0, 0}}, 0, inf, record));
+  }
+
+  SECTION("The root bounds all objects")
+  {
+    Arena arena;
+    const BVH bvh{make_spheres(arena, 10)};
+    REQUIRE(bvh.objects().size() == 10);
+    REQUIRE(bvh.bounding_box() == AABB({-1, -1, -1}, {28, 1, 1}));
+  }
+}
+
+TEST_CASE("Ray-BVH intersection", "[BVH]")
+{
+  Arena arena;
+  const BVH bvh{make_spheres(arena, 10)};
+  HitRecord record;
+
+  SECTION("Returns the closest hit")
+  {
+    REQUIRE(bvh.intersection_with(Ray{{-5, 0, 0}, {1, 0, 0}}, 0, inf, record));
+    REQUIRE(record.t == Approx(4));
+    const auto& sphere =
+        dynamic_cast<const Sphere&>(bvh.object(record.primitive_index));
+    REQUIRE(sphere.center.x == Approx(0));
+  }
+
+  SECTION("Returns the closest hit when travelling backward")
+  {
+    REQUIRE(
+        bvh.intersection_with(Ray{{40, 0, 0}, {-1, 0, 0}}, 0, inf, record));
+    REQUIRE(record.t == Approx(12));
+    const auto& sphere =
+        dynamic_cast<const Sphere&>(bvh.object(record.primitive_index));
+    REQUIRE(sphere.center.x == Approx(27));
+  }
+
+  SECTION("Misses when the ray passes by all the objects")
+  {
+    REQUIRE_FALSE(
+        bvh.intersection_with(Ray{{-5, 2, 0}, {1, 0, 0}}, 0, inf, record));
+  }
+}
+
+TEST_CASE("BVH refit", "[BVH]")
+{
+  Arena arena;
+  BVH bvh{make_spheres(arena, 10)};
+  const auto initial_cost = bvh.sah_cost();
+
+  auto& sphere = dynamic_cast<Sphere&>(bvh.object(0));
+  sphere.center.y = 10;
+  const Ray ray{{-5, 10, 0}, {1, 0, 0}};
+  HitRecord record;
+  REQUIRE_FALSE(bvh.intersection_with(ray, 0, inf, record));
+
+  bvh.refit();
+  REQUIRE(bvh.intersection_with(ray, 0, inf, record));
+  REQUIRE(record.t == Approx(4));
+  REQUIRE(bvh.bounding_box().max().y == Approx(11));
+
+  SECTION("Refitting degrades the SAH cost of the hierarchy")
+  {
+    REQUIRE(bvh.sah_cost() > initial_cost);
+  }
+
+  SECTION("Rebuilding keeps the hit results")
+  {
+    bvh.rebuild();
+    HitRecord rebuilt_record;
+    REQUIRE(bvh.intersection_with(ray, 0, inf, rebuilt_record));
+    REQUIRE(rebuilt_record.t == Approx(4));
+  }
+}
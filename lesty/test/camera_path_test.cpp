@@ -0,0 +1,36 @@
+#include <catch2/catch.hpp>
+
+#include "camera_path.hpp"
+
+using lesty::Camera_keyframe;
+using lesty::Camera_path;
+using lesty::Camera_settings;
+
+TEST_CASE("Camera path", "[camera]")
+{
+  const Camera_settings start{{0, 0, 0}, {0, 0, 1}, {0, 1, 0}, 40};
+  const Camera_settings end{{4, 0, 0}, {4, 0, 1}, {0, 1, 0}, 60};
+  const Camera_path path{
+      {Camera_keyframe{0, start}, Camera_keyframe{2, end}}, 5};
+
+  SECTION("Frames are evenly distributed along the path")
+  {
+    REQUIRE(path.frame_time(0) == Approx(0));
+    REQUIRE(path.frame_time(2) == Approx(1));
+    REQUIRE(path.frame_time(4) == Approx(2));
+  }
+
+  SECTION("Keyframes are linearly interpolated")
+  {
+    const auto keyframe = path.keyframe_at(0.5f);
+    REQUIRE(keyframe.settings.position.x == Approx(1));
+    REQUIRE(keyframe.settings.lookat.x == Approx(1));
+    REQUIRE(keyframe.settings.fov == Approx(45));
+  }
+
+  SECTION("Times out of the path are clamped")
+  {
+    REQUIRE(path.keyframe_at(-1).settings.position.x == Approx(0));
+    REQUIRE(path.keyframe_at(3).settings.position.x == Approx(4));
+  }
+}
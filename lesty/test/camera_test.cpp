@@ -0,0 +1,51 @@
+#include <catch2/catch.hpp>
+
+#include "camera.hpp"
+
+using lesty::Camera;
+using lesty::Camera_sample;
+using lesty::Camera_settings;
+
+TEST_CASE("Camera", "[camera]")
+{
+  const Camera_settings settings{{0, 0, 0}, {0, 0, -1}, {0, 1, 0}, 90};
+
+  SECTION("Generates normalized rays")
+  {
+    const Camera camera{settings, 1};
+    const auto ray = camera.get_ray(Camera_sample{{0, 0}});
+    REQUIRE(ray.direction.length() == Approx(1));
+    REQUIRE(ray.direction.x == Approx(-1 / std::sqrt(3.f)));
+    REQUIRE(ray.inv_direction.x == Approx(-std::sqrt(3.f)));
+  }
+
+  SECTION("Rays through the same film position converge at the focus plane")
+  {
+    auto lens_settings = settings;
+    lens_settings.aperture = 1;
+    lens_settings.focus_distance = 5;
+    const Camera camera{lens_settings, 1};
+    REQUIRE(camera.has_lens());
+
+    const auto r1 = camera.get_ray(Camera_sample{{0.3f, 0.6f}, {0.1f, 0.2f}});
+    const auto r2 = camera.get_ray(Camera_sample{{0.3f, 0.6f}, {0.9f, 0.7f}});
+    REQUIRE(r1.origin != r2.origin);
+
+    const auto p1 = r1(5 / -r1.direction.z);
+    const auto p2 = r2(5 / -r2.direction.z);
+    REQUIRE(p1.x == Approx(p2.x));
+    REQUIRE(p1.y == Approx(p2.y));
+  }
+
+  SECTION("Samples the shutter interval")
+  {
+    auto blur_settings = settings;
+    blur_settings.shutter_open = 0.2f;
+    blur_settings.shutter_close = 0.6f;
+    const Camera camera{blur_settings, 1};
+    REQUIRE(camera.has_motion_blur());
+
+    const auto ray = camera.get_ray(Camera_sample{{0.5f, 0.5f}, {}, 0.5f});
+    REQUIRE(ray.time == Approx(0.4f));
+  }
+}
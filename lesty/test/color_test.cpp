@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 
+#include <limits>
+
 #include "color.hpp"
 
 TEST_CASE("Colors", "[Color]")
@@ -73,3 +75,36 @@ TEST_CASE("Colors", "[Color]")
     REQUIRE(black.b == Approx(0));
   }
 }
+
+TEST_CASE("Colors in constant expressions", "[Color]")
+{
+  using lesty::Color;
+
+  // The operators fall back to scalar code at compile time
+  constexpr auto color =
+      (Color{1, 2, 3} + Color{1, 1, 1}) * Color{2, 2, 2} / 4.f - Color{1, 1, 1};
+  static_assert(color == Color{0, 0.5f, 1});
+
+  SECTION("Runtime results agree")
+  {
+    Color runtime{1, 2, 3};
+    runtime += Color{1, 1, 1};
+    runtime *= Color{2, 2, 2};
+    runtime /= 4.f;
+    runtime -= Color{1, 1, 1};
+    REQUIRE(runtime == color);
+  }
+}
+
+TEST_CASE("Padding of colors", "[Color]")
+{
+  using lesty::Color;
+
+  static_assert(sizeof(Color) == 16);
+  static_assert(alignof(Color) == 16);
+
+  const Color color{1, 2, 3};
+  REQUIRE((color / 0.f).padding == 0);
+  REQUIRE((color * std::numeric_limits<float>::infinity()).padding == 0);
+  REQUIRE((color * color + color - color).padding == 0);
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch.hpp>
+
+#include "denoise.hpp"
+#include "rng.hpp"
+
+using lesty::Color;
+using lesty::Image;
+
+namespace {
+
+constexpr std::size_t size = 32;
+
+auto fill(Color color) -> Image
+{
+  Image image{size, size};
+  for (std::size_t y = 0; y < size; ++y) {
+    for (std::size_t x = 0; x < size; ++x) {
+      image.color_at(x, y) = color;
+    }
+  }
+  return image;
+}
+
+// Adds uniform noise in [-amplitude, amplitude) to every channel
+auto add_noise(Image image, float amplitude) -> Image
+{
+  lesty::Rng rng{1};
+  for (std::size_t y = 0; y < size; ++y) {
+    for (std::size_t x = 0; x < size; ++x) {
+      const auto noise = [&]() {
+        return (rng.uniform_float() * 2 - 1) * amplitude;
+      };
+      image.color_at(x, y) += Color{noise(), noise(), noise()};
+    }
+  }
+  return image;
+}
+
+// Mean squared error of the red channel in the columns [begin, end)
+auto error(const Image& image, float expected, std::size_t begin,
+           std::size_t end) -> float
+{
+  float sum = 0;
+  for (std::size_t y = 0; y < size; ++y) {
+    for (std::size_t x = begin; x < end; ++x) {
+      const float d = image.color_at(x, y).r - expected;
+      sum += d * d;
+    }
+  }
+  return sum / static_cast<float>(size * (end - begin));
+}
+
+} // anonymous namespace
+
+TEST_CASE("Denoising", "[denoise]")
+{
+  const auto albedo = fill(Color{1, 1, 1});
+  auto normals = fill(Color{0, 0, 1});
+
+  SECTION("Flat images stay the same")
+  {
+    const auto image = fill(Color{0.2f, 0.4f, 0.6f});
+    const auto result = lesty::denoise(image, albedo, normals);
+    REQUIRE(result.color_at(5, 7).r == Approx(0.2f));
+    REQUIRE(result.color_at(31, 0).g == Approx(0.4f));
+    REQUIRE(result.color_at(16, 16).b == Approx(0.6f));
+  }
+
+  SECTION("Noise is removed")
+  {
+    const auto image = add_noise(fill(Color{0.5f, 0.5f, 0.5f}), 0.3f);
+    const auto result = lesty::denoise(image, albedo, normals);
+    REQUIRE(error(result, 0.5f, 0, size) < error(image, 0.5f, 0, size) / 10);
+  }
+
+  SECTION("Edges between normals are kept")
+  {
+    // The left half faces another way and is darker
+    auto image = fill(Color{0.8f, 0.8f, 0.8f});
+    for (std::size_t y = 0; y < size; ++y) {
+      for (std::size_t x = 0; x < size / 2; ++x) {
+        image.color_at(x, y) = Color{0.1f, 0.1f, 0.1f};
+        normals.color_at(x, y) = Color{1, 0, 0};
+      }
+    }
+    image = add_noise(image, 0.05f);
+    const auto result = lesty::denoise(image, albedo, normals);
+    REQUIRE(error(result, 0.1f, 0, size / 2) < 1e-3f);
+    REQUIRE(error(result, 0.8f, size / 2, size) < 1e-3f);
+  }
+
+  SECTION("Textures are kept")
+  {
+    auto checker = fill(Color{});
+    for (std::size_t y = 0; y < size; ++y) {
+      for (std::size_t x = 0; x < size; ++x) {
+        const float value = (x + y) % 2 == 0 ? 0.9f : 0.1f;
+        checker.color_at(x, y) = Color{value, value, value};
+      }
+    }
+    const auto result = lesty::denoise(checker, checker, normals);
+    REQUIRE(result.color_at(3, 5).r == Approx(0.9f));
+    REQUIRE(result.color_at(4, 5).r == Approx(0.1f));
+  }
+
+  SECTION("Empty images")
+  {
+    const Image empty{0, 0};
+    REQUIRE(lesty::denoise(empty, empty, empty).data().empty());
+  }
+
+  SECTION("Guides must match the size of the image")
+  {
+    const Image small{4, 4};
+    REQUIRE_THROWS_AS(lesty::denoise(small, albedo, normals),
+                      std::invalid_argument);
+  }
+}
@@ -0,0 +1,175 @@
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <thread>
+
+#include "bounding_volume_hierarchy.hpp"
+#include "geometry_cache.hpp"
+#include "image.hpp"
+#include "ray.hpp"
+#include "rng.hpp"
+#include "triangle.hpp"
+
+using lesty::Arena;
+using lesty::Arena_ptr;
+using lesty::BVH;
+using lesty::Geometry_cache;
+using lesty::Geometry_chunk;
+using lesty::Hitable;
+using lesty::HitRecord;
+using lesty::Ray;
+using lesty::Rng;
+using lesty::Triangle_vertices;
+
+static constexpr float inf = std::numeric_limits<float>::infinity();
+
+namespace {
+
+auto random_point(Rng& rng, float extent) -> beyond::Point3
+{
+  return {rng.uniform_float() * extent, rng.uniform_float() * extent,
+          rng.uniform_float() * extent};
+}
+
+// A grid of triangles with random heights in [0, 1)
+auto make_triangles(std::size_t count) -> std::vector<Triangle_vertices>
+{
+  Rng rng{7};
+  std::vector<Triangle_vertices> triangles;
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto x = static_cast<float>(i % 32);
+    const auto y = static_cast<float>(i / 32);
+    triangles.push_back({beyond::Point3{x, y, rng.uniform_float()},
+                         beyond::Point3{x + 1, y, rng.uniform_float()},
+                         beyond::Point3{x, y + 1, rng.uniform_float()}});
+  }
+  return triangles;
+}
+
+auto closest_t(const Hitable& hitable, const Ray& ray) -> float
+{
+  HitRecord record;
+  return hitable.intersection_with(ray, 0, inf, record) ? record.t : inf;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Baked geometry", "[geometry_cache]")
+{
+  const auto path =
+      std::filesystem::temp_directory_path() / "lesty_test_geometry.bin";
+  const auto triangles = make_triangles(1024);
+  lesty::bake_geometry(path.string(), triangles, 100);
+
+  Arena arena;
+  std::vector<Arena_ptr<Hitable>> reference_triangles;
+  for (const auto& t : triangles) {
+    reference_triangles.push_back(
+        arena.make<lesty::Triangle>(t[0], t[1], t[2], 0));
+  }
+  const BVH reference{std::move(reference_triangles)};
+
+  Geometry_cache cache;
+  auto chunks = cache.open(path.string(), 0, arena);
+  REQUIRE(chunks.size() >= 1024 / 100);
+
+  std::uint64_t triangle_count = 0;
+  for (const auto& chunk : chunks) {
+    const auto& geometry_chunk = dynamic_cast<const Geometry_chunk&>(*chunk);
+    REQUIRE(geometry_chunk.triangle_count() <= 100);
+    REQUIRE_FALSE(geometry_chunk.is_resident());
+    triangle_count += geometry_chunk.triangle_count();
+  }
+  REQUIRE(triangle_count == triangles.size());
+
+  const BVH scene{std::move(chunks)};
+  REQUIRE(scene.bounding_box() == reference.bounding_box());
+  REQUIRE(cache.load_count() == 0);
+
+  // Rays from above the grid
+  Rng rng{42};
+  std::vector<Ray> rays;
+  for (int i = 0; i < 200; ++i) {
+    const auto origin = random_point(rng, 32) + beyond::Vec3{0, 0, 40};
+    const auto target = random_point(rng, 32);
+    rays.push_back(Ray{origin, beyond::normalize(target - origin)});
+  }
+
+  SECTION("Chunks are loaded on demand and give the same hits")
+  {
+    for (const auto& ray : rays) {
+      REQUIRE(closest_t(scene, ray) == closest_t(reference, ray));
+    }
+    REQUIRE(cache.load_count() > 0);
+    REQUIRE(cache.load_count() <= scene.objects().size());
+  }
+
+  SECTION("Chunks are evicted to stay within the budget")
+  {
+    for (const auto& ray : rays) {
+      REQUIRE(closest_t(scene, ray) == closest_t(reference, ray));
+    }
+    // About two chunks
+    const auto budget = cache.memory_size() * 2 / cache.load_count();
+    cache.set_budget(budget);
+    REQUIRE(cache.memory_size() <= budget);
+
+    for (const auto& ray : rays) {
+      REQUIRE(closest_t(scene, ray) == closest_t(reference, ray));
+      REQUIRE(cache.memory_size() <= budget);
+    }
+    REQUIRE(cache.load_count() > scene.objects().size());
+  }
+
+  SECTION("Chunks can be evicted while other threads intersect them")
+  {
+    for (const auto& ray : rays) {
+      REQUIRE(closest_t(scene, ray) == closest_t(reference, ray));
+    }
+    cache.set_budget(cache.memory_size() * 2 / cache.load_count());
+
+    // Threads that hold a guard for all of their rays, and threads that take
+    // one per intersection
+    std::vector<char> matches(4, false);
+    {
+      std::vector<std::jthread> threads;
+      for (std::size_t i = 0; i < matches.size(); ++i) {
+        threads.emplace_back([&, i] {
+          std::optional<Geometry_cache::Read_guard> guard;
+          if (i % 2 == 0) {
+            guard.emplace(&cache);
+          }
+          bool match = true;
+          for (int pass = 0; pass < 10; ++pass) {
+            for (const auto& ray : rays) {
+              match = match &&
+                      closest_t(scene, ray) == closest_t(reference, ray);
+            }
+          }
+          matches[i] = match;
+        });
+      }
+    }
+    for (const auto match : matches) {
+      REQUIRE(match);
+    }
+  }
+}
+
+TEST_CASE("Baked geometry files are validated", "[geometry_cache]")
+{
+  const auto path =
+      std::filesystem::temp_directory_path() / "lesty_test_geometry.txt";
+  {
+    std::ofstream file{path};
+    file << "not a geometry file";
+  }
+
+  Arena arena;
+  Geometry_cache cache;
+  REQUIRE_THROWS_AS(cache.open(path.string(), 0, arena),
+                    lesty::Cannot_read_file);
+}
@@ -1,5 +1,11 @@
 #include <catch2/catch.hpp>
 
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "heatmap.hpp"
 #include "image.hpp"
 
 TEST_CASE("Image", "[Graphics]")
@@ -27,3 +33,207 @@ TEST_CASE("Image", "[Graphics]")
     REQUIRE_THROWS_AS(img.color_at(0, 100), std::out_of_range);
   }
 }
+
+TEST_CASE("Save images", "[Graphics]")
+{
+  using lesty::Color;
+  using lesty::Image;
+
+  Image img(4, 2);
+  img.color_at(0, 0) = Color{1, 2, 3};
+
+  const auto directory = std::filesystem::temp_directory_path();
+  const auto file_size = [](const std::filesystem::path& path) {
+    return static_cast<std::size_t>(std::filesystem::file_size(path));
+  };
+
+  SECTION("Throws on unsupported extensions")
+  {
+    REQUIRE_THROWS_AS(img.saveto((directory / "lesty_test.bmp").string()),
+                      lesty::Unsupported_image_extension);
+  }
+
+  SECTION("Saves portable float maps")
+  {
+    const auto path = directory / "lesty_test.pfm";
+    img.saveto(path.string());
+
+    std::ifstream file{path, std::ios::binary};
+    std::string header;
+    std::getline(file, header);
+    REQUIRE(header == "PF");
+    std::getline(file, header);
+    REQUIRE(header == "4 2");
+    std::getline(file, header);
+    REQUIRE(header == "-1.0");
+    REQUIRE(file_size(path) == 12 + 4 * 2 * 3 * sizeof(float));
+  }
+
+  SECTION("Saves raw images as packed RGB floats")
+  {
+    const auto path = directory / "lesty_test.raw";
+    img.saveto(path.string());
+    REQUIRE(file_size(path) == 32 + 4 * 2 * 3 * sizeof(float));
+
+    std::ifstream file{path, std::ios::binary};
+    file.seekg(32);
+    float red = 0;
+    file.read(reinterpret_cast<char*>(&red), sizeof(float));
+    REQUIRE(red == Approx(1));
+  }
+
+  SECTION("Loads raw images back")
+  {
+    const auto path = directory / "lesty_test.raw";
+    img.set_sample_count(16);
+    img.saveto(path.string());
+
+    const auto loaded = Image::load_raw(path.string());
+    REQUIRE(loaded.width() == 4);
+    REQUIRE(loaded.height() == 2);
+    REQUIRE(loaded.sample_count() == 16);
+    REQUIRE(loaded.color_at(0, 0).r == Approx(1));
+
+    const auto bad_path = directory / "lesty_test_bad.raw";
+    std::ofstream{bad_path} << "not a raw image";
+    REQUIRE_THROWS_AS(Image::load_raw(bad_path.string()),
+                      lesty::Cannot_read_file);
+  }
+
+  SECTION("Saves OpenEXR images")
+  {
+    const auto path = directory / "lesty_test.exr";
+    img.saveto(path.string());
+
+    std::ifstream file{path, std::ios::binary};
+    std::array<unsigned char, 4> magic{};
+    file.read(reinterpret_cast<char*>(magic.data()), magic.size());
+    REQUIRE(magic == std::array<unsigned char, 4>{0x76, 0x2f, 0x31, 0x01});
+  }
+
+  SECTION("Encodes png images in memory")
+  {
+    const auto png = img.to_png();
+    REQUIRE(png.size() > 8);
+    REQUIRE(std::equal(png.begin(), png.begin() + 4,
+                       std::array<unsigned char, 4>{0x89, 'P', 'N', 'G'}
+                           .begin()));
+  }
+}
+
+TEST_CASE("Tone mapping to 8 bits", "[Graphics]")
+{
+  using lesty::Color;
+  using lesty::Image;
+  using Transfer = Image::Transfer;
+
+  // Rows of the output start from the top, so the second row comes first
+  Image img(1, 2);
+  img.color_at(0, 0) = Color{0, 0.5f, 1};
+  img.color_at(0, 1) = Color{4, 100, -1};
+
+  SECTION("Values out of [0, 1] are clamped")
+  {
+    for (const auto transfer : {Transfer::gamma, Transfer::linear,
+                                Transfer::srgb}) {
+      const auto bytes = img.to_8bit(transfer);
+      REQUIRE(bytes.size() == 6);
+      REQUIRE(bytes[0] == 255);
+      REQUIRE(bytes[1] == 255);
+      REQUIRE(bytes[2] == 0);
+      REQUIRE(bytes[3] == 0);
+      REQUIRE(bytes[5] == 255);
+    }
+  }
+
+  SECTION("sRGB encoding")
+  {
+    const auto bytes = img.to_8bit(Transfer::srgb);
+    REQUIRE(bytes[4] == 188);
+  }
+
+  SECTION("Reinhard compresses highlights")
+  {
+    REQUIRE(lesty::tonemap(Color{1, 1, 1}, Transfer::reinhard).r ==
+            Approx(0.5f));
+    const auto bytes = img.to_8bit(Transfer::reinhard);
+    REQUIRE(bytes[0] == 232); // 4 / 5
+    REQUIRE(bytes[1] == 254); // 100 / 101
+    REQUIRE(bytes[3] == 0);
+    REQUIRE(bytes[5] == 188); // 1 / 2
+  }
+
+  SECTION("ACES is monotonic and saturates")
+  {
+    REQUIRE(lesty::tonemap(Color{}, Transfer::aces).r ==
+            Approx(0).margin(1e-6));
+    float previous = 0;
+    for (float x = 0.01f; x < 100; x *= 1.5f) {
+      const auto mapped = lesty::tonemap(Color{x, x, x}, Transfer::aces).r;
+      REQUIRE(mapped > previous);
+      previous = mapped;
+    }
+    REQUIRE(img.to_8bit(Transfer::aces)[1] == 255);
+  }
+}
+
+TEST_CASE("Merge sample ranges", "[Graphics]")
+{
+  using lesty::Color;
+  using lesty::Image;
+
+  std::vector<Image> images{Image(2, 1), Image(2, 1)};
+  images[0].color_at(0, 0) = Color{1, 1, 1};
+  images[0].set_sample_count(3);
+  images[1].color_at(0, 0) = Color{0, 0, 0};
+  images[1].set_sample_count(1);
+
+  SECTION("Weights the images by their sample counts")
+  {
+    const auto merged = lesty::merge_sample_ranges(images);
+    REQUIRE(merged.sample_count() == 4);
+    REQUIRE(merged.color_at(0, 0).r == Approx(0.75));
+    REQUIRE(merged.color_at(1, 0).r == Approx(0));
+  }
+
+  SECTION("Rejects images that cannot be merged")
+  {
+    REQUIRE_THROWS_AS(lesty::merge_sample_ranges({}), std::invalid_argument);
+
+    images[1].set_sample_count(0);
+    REQUIRE_THROWS_AS(lesty::merge_sample_ranges(images),
+                      std::invalid_argument);
+
+    images.emplace_back(1, 1);
+    images.back().set_sample_count(1);
+    images[1].set_sample_count(1);
+    REQUIRE_THROWS_AS(lesty::merge_sample_ranges(images),
+                      std::invalid_argument);
+  }
+}
+
+TEST_CASE("False color heatmap", "[Graphics]")
+{
+  using lesty::Color;
+  using lesty::Image;
+
+  Image costs(4, 1);
+  costs.color_at(0, 0) = Color{0.4f, 0.4f, 0.4f};
+  costs.color_at(1, 0) = Color{1, 1, 1};
+  costs.color_at(2, 0) = Color{2, 2, 2};
+  costs.color_at(3, 0) = Color{2, 2, 2};
+
+  const auto heatmap = lesty::false_color_heatmap(costs);
+  REQUIRE(heatmap.width() == 4);
+
+  // Cheap pixels are blue, expensive pixels are red
+  const auto cheap = heatmap.color_at(0, 0);
+  const auto expensive = heatmap.color_at(3, 0);
+  REQUIRE(cheap.b > cheap.r);
+  REQUIRE(expensive.r > expensive.b);
+  for (std::size_t x = 0; x < 4; ++x) {
+    const auto color = heatmap.color_at(x, 0);
+    REQUIRE(color.r >= 0);
+    REQUIRE(color.r <= 1);
+  }
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include "material.hpp"
+#include "sampling.hpp"
+
+using lesty::Color;
+using lesty::HitRecord;
+using lesty::Material;
+using lesty::Ray;
+using lesty::Rng;
+
+TEST_CASE("BSDF sampling", "[material]")
+{
+  // A ray that hits the plane z = 0 at 45 degrees
+  const Ray ray{{-1, 0, 1}, beyond::normalize(beyond::Vec3{1, 0, -1})};
+  const HitRecord record{std::sqrt(2.f), {0, 0, 0}, {0, 0, 1}, 0, 0};
+  Rng rng{42};
+
+  SECTION("Lambertian surfaces scatter into the hemisphere of the normal")
+  {
+    const auto material = Material::lambertian(Color{0.2f, 0.4f, 0.6f});
+    for (int i = 0; i < 100; ++i) {
+      const auto sample = sample_bsdf(material, ray, record, rng);
+      REQUIRE_FALSE(sample.is_absorbed());
+      REQUIRE(sample.direction.z >= 0);
+      REQUIRE(sample.weight == material.color);
+      REQUIRE(sample.pdf == Approx(sample.direction.z / lesty::pi));
+    }
+  }
+
+  SECTION("Rough metals reflect around the mirror direction")
+  {
+    const auto material = Material::metal(Color{1, 1, 1}, 0.1f);
+    beyond::Vec3 sum{};
+    for (int i = 0; i < 1000; ++i) {
+      const auto sample = sample_bsdf(material, ray, record, rng);
+      if (sample.is_absorbed()) {
+        continue;
+      }
+      REQUIRE(sample.direction.z > 0);
+      REQUIRE(sample.weight.r <= 1);
+      REQUIRE(sample.pdf > 0);
+      sum += sample.direction;
+    }
+    // GGX has long tails, but the samples concentrate around the mirror
+    // direction
+    const auto mean = normalize(sum);
+    REQUIRE(mean.x == Approx(ray.direction.x).epsilon(0.05));
+    REQUIRE(mean.z == Approx(-ray.direction.z).epsilon(0.05));
+  }
+
+  SECTION("Smooth metals reflect like a mirror")
+  {
+    const auto material = Material::metal(Color{1, 1, 1}, 0);
+    const auto sample = sample_bsdf(material, ray, record, rng);
+    REQUIRE(sample.pdf == 1);
+    REQUIRE(sample.direction.x == Approx(ray.direction.x));
+    REQUIRE(sample.direction.z == Approx(-ray.direction.z));
+  }
+
+  SECTION("Emissive surfaces absorb every ray")
+  {
+    const auto material = Material::emission(Color{4, 4, 4});
+    REQUIRE(sample_bsdf(material, ray, record, rng).is_absorbed());
+    REQUIRE(emitted(material) == Color{4, 4, 4});
+    REQUIRE(emitted(Material::lambertian(Color{1, 1, 1})) == Color{});
+  }
+}
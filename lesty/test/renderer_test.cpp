@@ -0,0 +1,253 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <stop_token>
+#include <vector>
+
+#include "material.hpp"
+#include "renderer.hpp"
+#include "scene.hpp"
+#include "sphere.hpp"
+
+using lesty::Aov;
+using lesty::Arena;
+using lesty::Arena_ptr;
+using lesty::Camera_settings;
+using lesty::Color;
+using lesty::Hitable;
+using lesty::Material;
+using lesty::Options;
+using lesty::Renderer;
+using lesty::Scene;
+using lesty::Sphere;
+
+namespace {
+
+auto make_scene() -> Scene
+{
+  auto arena = std::make_unique<Arena>();
+  const std::vector<Material> materials{
+      Material::lambertian(Color(0.5f, 0.5f, 0.5f)),
+      Material::emission(Color(4, 4, 4))};
+
+  std::vector<Arena_ptr<Hitable>> objects;
+  objects.push_back(arena->make<Sphere>(beyond::Point3{0, 0, 3}, 1, 0));
+  objects.push_back(arena->make<Sphere>(beyond::Point3{0, 3, 3}, 1, 1));
+  return Scene{std::move(arena), std::move(objects), materials};
+}
+
+auto make_renderer(std::uint64_t seed, bool denoise = false)
+    -> std::unique_ptr<Renderer>
+{
+  Options options{};
+  options.width = 16;
+  options.height = 16;
+  options.spp = 4;
+  options.seed = seed;
+  options.denoise = denoise;
+  const Camera_settings camera{{0, 0, 0}, {0, 0, 1}, {0, 1, 0}, 60};
+  return create_renderers(Renderer::Type::path, options, camera);
+}
+
+auto render(const Scene& scene, std::uint64_t seed) -> lesty::Image
+{
+  return make_renderer(seed)->render(scene);
+}
+
+auto same_pixels(const lesty::Image& lhs, const lesty::Image& rhs) -> bool
+{
+  const auto& a = lhs.data();
+  const auto& b = rhs.data();
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const Color& x, const Color& y) {
+                      return x.r == y.r && x.g == y.g && x.b == y.b;
+                    });
+}
+
+} // anonymous namespace
+
+TEST_CASE("Seeded renders", "[renderer]")
+{
+  const auto scene = make_scene();
+
+  SECTION("Renders with the same seed are identical")
+  {
+    REQUIRE(same_pixels(render(scene, 1), render(scene, 1)));
+  }
+
+  SECTION("Renders with different seeds differ")
+  {
+    REQUIRE_FALSE(same_pixels(render(scene, 1), render(scene, 2)));
+  }
+}
+
+TEST_CASE("Stopped renders skip their tiles", "[renderer]")
+{
+  const auto scene = make_scene();
+  std::stop_source stop;
+  stop.request_stop();
+  const auto image = make_renderer(1)->render(scene, stop.get_token());
+  REQUIRE(std::ranges::all_of(image.data(),
+                              [](const Color& c) { return c == Color{}; }));
+  REQUIRE(image.sample_count() == 0);
+  REQUIRE(render(scene, 1).sample_count() == 4);
+}
+
+TEST_CASE("Images only have the sample count of all their tiles",
+          "[renderer]")
+{
+  using lesty::Tile;
+  using lesty::TileDesc;
+
+  const auto renderer = make_renderer(1);
+  std::vector<Tile> tiles;
+  tiles.emplace_back(TileDesc{0, 0, 8, 16});
+  tiles.emplace_back(TileDesc{8, 0, 8, 16});
+  tiles[0].set_sample_count(4);
+  tiles[1].set_sample_count(4);
+  REQUIRE(renderer->common_sample_count(tiles) == 4);
+
+  // A tile that was stopped early
+  tiles[1].set_sample_count(2);
+  REQUIRE(renderer->common_sample_count(tiles) == 0);
+}
+
+TEST_CASE("AOVs of the first hits", "[renderer]")
+{
+  const auto scene = make_scene();
+  const auto renderer = make_renderer(1);
+  renderer->set_aovs({Aov::depth, Aov::normal, Aov::albedo,
+                      Aov::primitive_id, Aov::material_id});
+
+  // Recording AOVs does not change the image
+  const auto image = renderer->render(scene);
+  REQUIRE(same_pixels(image, render(scene, 1)));
+  const auto& aovs = renderer->aov_buffers();
+  REQUIRE(aovs.width() == 16);
+  REQUIRE(aovs.height() == 16);
+
+  SECTION("The sphere in front of the camera")
+  {
+    REQUIRE(aovs.at(Aov::depth, 0, 8, 8) == Approx(2).epsilon(0.01));
+    REQUIRE(aovs.at(Aov::normal, 2, 8, 8) == Approx(-1).epsilon(0.05));
+    REQUIRE(aovs.at(Aov::albedo, 0, 8, 8) == Approx(0.5f));
+    REQUIRE(aovs.at(Aov::primitive_id, 0, 8, 8) >= 0);
+    REQUIRE(aovs.at(Aov::material_id, 0, 8, 8) == 0);
+  }
+
+  SECTION("Nothing is hit in the corners")
+  {
+    REQUIRE(std::isinf(aovs.at(Aov::depth, 0, 0, 0)));
+    REQUIRE(aovs.to_image(Aov::normal).color_at(15, 15) == Color{});
+    REQUIRE(aovs.to_image(Aov::albedo).color_at(0, 15) == Color{});
+    REQUIRE(aovs.at(Aov::primitive_id, 0, 15, 0) == -1);
+    REQUIRE(aovs.at(Aov::material_id, 0, 15, 0) == -1);
+  }
+
+  SECTION("Nothing is recorded by default")
+  {
+    const auto plain = make_renderer(1);
+    [[maybe_unused]] const auto plain_image = plain->render(scene);
+    REQUIRE(plain->aov_buffers().empty());
+  }
+}
+
+TEST_CASE("Denoising records the guides", "[renderer]")
+{
+  const auto renderer = make_renderer(1, true);
+  REQUIRE(renderer->aovs().contains(Aov::albedo));
+  REQUIRE(renderer->aovs().contains(Aov::normal));
+  REQUIRE_FALSE(renderer->aovs().contains(Aov::depth));
+}
+
+TEST_CASE("Cropped renders", "[renderer]")
+{
+  using lesty::TileDesc;
+
+  const auto scene = make_scene();
+  const auto full = render(scene, 1);
+  const auto renderer = make_renderer(1);
+  const TileDesc crop{3, 5, 7, 4};
+  renderer->set_crop(crop);
+  const auto cropped = renderer->render(scene);
+
+  for (std::size_t y = 0; y < cropped.height(); ++y) {
+    for (std::size_t x = 0; x < cropped.width(); ++x) {
+      const bool inside = x >= crop.start_x && x < crop.start_x + crop.width &&
+                          y >= crop.start_y && y < crop.start_y + crop.height;
+      REQUIRE(cropped.color_at(x, y) ==
+              (inside ? full.color_at(x, y) : Color{}));
+    }
+  }
+  // The black pixels would darken a merge
+  REQUIRE(cropped.sample_count() == 0);
+
+  REQUIRE_THROWS_AS(renderer->set_crop(TileDesc{10, 0, 7, 4}),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(renderer->set_crop(TileDesc{0, 0, 0, 4}),
+                    std::invalid_argument);
+}
+
+TEST_CASE("Tile order", "[renderer]")
+{
+  using lesty::Tile_order;
+  using lesty::TileDesc;
+
+  const Camera_settings camera{{0, 0, 0}, {0, 0, 1}, {0, 1, 0}, 60};
+  Options options{};
+  options.width = 100;
+  options.height = 70;
+  options.spp = 1;
+  const auto renderer =
+      create_renderers(Renderer::Type::path, options, camera);
+
+  const auto covered_pixels = [](const std::vector<TileDesc>& descs) {
+    std::size_t count = 0;
+    for (const auto& desc : descs) {
+      count += desc.width * desc.height;
+    }
+    return count;
+  };
+
+  SECTION("Scanline order starts from the bottom left")
+  {
+    renderer->set_tile_order(Tile_order::scanline);
+    const auto descs = renderer->tile_descs();
+    REQUIRE(descs.size() == 4 * 3);
+    REQUIRE(descs.front().start_x == 0);
+    REQUIRE(descs.front().start_y == 0);
+    REQUIRE(covered_pixels(descs) == 100 * 70);
+  }
+
+  SECTION("Center order starts from the tile at the center")
+  {
+    renderer->set_tile_order(Tile_order::center);
+    const auto descs = renderer->tile_descs();
+    REQUIRE(descs.size() == 4 * 3);
+    REQUIRE(descs.front().start_x <= 50);
+    REQUIRE(descs.front().start_x + descs.front().width > 50);
+    REQUIRE(descs.front().start_y <= 35);
+    REQUIRE(descs.front().start_y + descs.front().height > 35);
+    REQUIRE(covered_pixels(descs) == 100 * 70);
+  }
+
+  SECTION("Tiles of a crop stay on the grid of the whole image")
+  {
+    renderer->set_crop(TileDesc{20, 30, 50, 10});
+    const auto descs = renderer->tile_descs();
+    REQUIRE(descs.size() == 3 * 2);
+    REQUIRE(covered_pixels(descs) == 50 * 10);
+    for (const auto& desc : descs) {
+      REQUIRE(desc.start_x >= 20);
+      REQUIRE(desc.start_x + desc.width <= 70);
+      REQUIRE(desc.start_y >= 30);
+      REQUIRE(desc.start_y + desc.height <= 40);
+      REQUIRE(desc.start_x / lesty::tile_size ==
+              (desc.start_x + desc.width - 1) / lesty::tile_size);
+      REQUIRE(desc.start_y / lesty::tile_size ==
+              (desc.start_y + desc.height - 1) / lesty::tile_size);
+    }
+  }
+}
@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+
+#include "rng.hpp"
+
+using lesty::mix_seed;
+using lesty::Rng;
+
+TEST_CASE("Rng", "[rng]")
+{
+  SECTION("Same seeds give the same sequence")
+  {
+    Rng a{42};
+    Rng b{42};
+    for (int i = 0; i < 16; ++i) {
+      REQUIRE(a() == b());
+    }
+  }
+
+  SECTION("Different seeds give different sequences")
+  {
+    Rng a{mix_seed(0, 1)};
+    Rng b{mix_seed(0, 2)};
+    bool all_same = true;
+    for (int i = 0; i < 16; ++i) {
+      all_same = all_same && (a() == b());
+    }
+    REQUIRE(!all_same);
+  }
+
+  SECTION("Uniform floats lie in [0, 1)")
+  {
+    Rng rng{7};
+    for (int i = 0; i < 1000; ++i) {
+      const float x = rng.uniform_float();
+      REQUIRE(x >= 0);
+      REQUIRE(x < 1);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+
+#include "rng.hpp"
+#include "sampling.hpp"
+
+using beyond::Vec3;
+using lesty::Onb;
+using lesty::Rng;
+
+TEST_CASE("Orthonormal basis", "[sampling]")
+{
+  const auto n =
+      GENERATE(Vec3{0, 0, 1}, Vec3{0, 0, -1}, Vec3{1, 0, 0},
+               normalize(Vec3{1, -2, 3}), normalize(Vec3{-1, 1, -1}));
+  const auto basis = Onb::from_normal(n);
+
+  REQUIRE(dot(basis.tangent, basis.tangent) == Approx(1));
+  REQUIRE(dot(basis.bitangent, basis.bitangent) == Approx(1));
+  REQUIRE(dot(basis.tangent, basis.bitangent) == Approx(0).margin(1e-6));
+  REQUIRE(dot(basis.tangent, n) == Approx(0).margin(1e-6));
+  REQUIRE(dot(basis.bitangent, n) == Approx(0).margin(1e-6));
+
+  const Vec3 v{0.3f, -0.4f, 0.5f};
+  const auto round_trip = basis.to_local(basis.to_world(v));
+  REQUIRE(round_trip.x == Approx(v.x));
+  REQUIRE(round_trip.y == Approx(v.y));
+  REQUIRE(round_trip.z == Approx(v.z));
+}
+
+TEST_CASE("Hemisphere sampling", "[sampling]")
+{
+  Rng rng{42};
+  constexpr int count = 100'000;
+
+  SECTION("Cosine weighted samples have a mean cosine of 2/3")
+  {
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+      const auto v = lesty::sample_cosine_hemisphere(rng.uniform_float(),
+                                                     rng.uniform_float());
+      REQUIRE(dot(v, v) == Approx(1));
+      REQUIRE(v.z > 0);
+      sum += static_cast<double>(v.z);
+    }
+    REQUIRE(sum / count == Approx(2.0 / 3.0).epsilon(0.01));
+  }
+
+  SECTION("Visible normals of GGX face the view direction")
+  {
+    const auto wo = normalize(Vec3{1, 0, 1});
+    for (int i = 0; i < 1000; ++i) {
+      const auto h = lesty::sample_ggx_visible_normal(
+          wo, 0.5f, rng.uniform_float(), rng.uniform_float());
+      REQUIRE(dot(h, h) == Approx(1));
+      REQUIRE(h.z >= 0);
+      REQUIRE(dot(wo, h) >= 0);
+    }
+  }
+
+  SECTION("A smooth white GGX surface reflects almost all the energy")
+  {
+    // Estimates the directional albedo, G1(wi) averaged over visible normals
+    const auto wo = normalize(Vec3{1, 0, 2});
+    const float alpha = 0.1f;
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+      const auto h = lesty::sample_ggx_visible_normal(
+          wo, alpha, rng.uniform_float(), rng.uniform_float());
+      const auto wi = 2 * dot(wo, h) * h - wo;
+      if (wi.z > 0) {
+        sum += static_cast<double>(lesty::ggx_smith_g1(wi, alpha));
+      }
+    }
+    const auto albedo = sum / count;
+    REQUIRE(albedo <= 1);
+    REQUIRE(albedo > 0.97);
+  }
+}
@@ -1,6 +1,86 @@
+#include "geometry_cache.hpp"
 #include "ray.hpp"
 #include "scene.hpp"
+#include "scene_parser.hpp"
 #include "sphere.hpp"
 #include <catch2/catch.hpp>
 
-// TODO(lesley):
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+using lesty::Arena;
+using lesty::Arena_ptr;
+using lesty::Color;
+using lesty::Hitable;
+using lesty::Material;
+using lesty::Ray;
+using lesty::Scene;
+using lesty::Sphere;
+
+TEST_CASE("Animate objects of a scene", "[scene]")
+{
+  auto arena = std::make_unique<Arena>();
+  const std::vector<Material> materials{
+      Material::lambertian(Color(0.5f, 0.5f, 0.5f))};
+
+  std::vector<Arena_ptr<Hitable>> objects;
+  for (int i = 0; i < 8; ++i) {
+    objects.push_back(arena->make<Sphere>(
+        beyond::Point3{static_cast<float>(i) * 3, 0, 0}, 1, 0));
+  }
+  Scene scene{std::move(arena), std::move(objects), materials};
+
+  auto sphere = [&scene](std::size_t index) -> Sphere& {
+    return dynamic_cast<Sphere&>(scene.object(index));
+  };
+  auto move_spheres = [&](float offset) {
+    for (std::size_t i = 0; i < scene.objects().size(); ++i) {
+      sphere(i).center.y += offset;
+    }
+  };
+
+  SECTION("Small motions only refit the BVH")
+  {
+    move_spheres(0.5f);
+    REQUIRE_FALSE(scene.update_bvh());
+
+    lesty::HitRecord record;
+    REQUIRE(scene.intersect_at(Ray{{-5, 0.5f, 0}, {1, 0, 0}}, record));
+    REQUIRE(record.t == Approx(4));
+  }
+
+  SECTION("Scattering the objects triggers a rebuild")
+  {
+    for (std::size_t i = 0; i < scene.objects().size(); ++i) {
+      sphere(i).center.y = sphere(i).center.x * 10;
+      sphere(i).center.x = 0;
+    }
+    REQUIRE(scene.update_bvh());
+    lesty::HitRecord record;
+    REQUIRE(scene.intersect_at(Ray{{0, -5, 0}, {0, 1, 0}}, record));
+  }
+}
+
+TEST_CASE("Paths of a scene file are relative to its directory", "[scene]")
+{
+  const auto directory =
+      std::filesystem::temp_directory_path() / "lesty_test_scene";
+  std::filesystem::create_directories(directory);
+  const std::array<lesty::Triangle_vertices, 1> triangles{
+      {{beyond::Point3{0, 0, 0}, beyond::Point3{1, 0, 0},
+        beyond::Point3{0, 1, 0}}}};
+  lesty::bake_geometry((directory / "mesh.bin").string(), triangles);
+
+  const auto scene_path = directory / "scene.json";
+  {
+    std::ofstream scene_file{scene_path};
+    scene_file << R"({"title": "relative", "materials": [
+      {"type": "Lambertian", "albedo": [0.5, 0.5, 0.5]}],
+      "objects": [{"type": "BakedMesh", "file": "mesh.bin", "material": 0}]})";
+  }
+
+  std::ifstream file{scene_path};
+  const auto scene = lesty::parse_scene(file, directory);
+  REQUIRE(scene.objects().size() == 1);
+}
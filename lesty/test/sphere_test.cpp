@@ -4,11 +4,11 @@
 #include <limits>
 
 using lesty::AABB;
-using lesty::Color;
+using lesty::HitRecord;
 using lesty::Ray;
 using lesty::Sphere;
 
-static const lesty::Lambertian dummy_mat{Color(0.5f, 0.5f, 0.5f)};
+static constexpr std::uint32_t dummy_mat = 0;
 constexpr float inf = std::numeric_limits<float>::infinity();
 
 TEST_CASE("AABBs for sphere", "[geometry] [sphere] [AABB]")
@@ -22,18 +22,20 @@ TEST_CASE("Ray-Sphere intersection", "[geometry] [sphere]")
 {
   Ray ray({0, 0, 0}, {0, 0, 1});
 
+  HitRecord record;
+
   SECTION(
-      "intersection_with returns nullopt if sphere does not intersect the ray")
+      "intersection_with returns false if sphere does not intersect the ray")
   {
     Sphere sphere{{0, 2, 0}, 1, dummy_mat};
-    REQUIRE_FALSE(sphere.intersection_with(ray, 0, inf));
+    REQUIRE_FALSE(sphere.intersection_with(ray, 0, inf, record));
   }
 
-  SECTION("intersection_with returns nullopt if intersections happened behind "
+  SECTION("intersection_with returns false if intersections happened behind "
           "the ray")
   {
     Sphere sphere{{0, 0, -2}, 1, dummy_mat};
-    REQUIRE_FALSE(sphere.intersection_with(ray, 0, inf));
+    REQUIRE_FALSE(sphere.intersection_with(ray, 0, inf, record));
   }
 
   SECTION(
@@ -41,9 +43,8 @@ TEST_CASE("Ray-Sphere intersection", "[geometry] [sphere]")
       "two points")
   {
     Sphere sphere{{0, 0, 2}, 1, dummy_mat};
-    const auto result = sphere.intersection_with(ray, 0, inf);
-    REQUIRE(result);
-    REQUIRE(result->t == Approx(1));
+    REQUIRE(sphere.intersection_with(ray, 0, inf, record));
+    REQUIRE(record.t == Approx(1));
   }
 
   SECTION(
@@ -51,8 +52,7 @@ TEST_CASE("Ray-Sphere intersection", "[geometry] [sphere]")
       "happened behind the ray")
   {
     Sphere sphere{{0, 0, 0}, 2, dummy_mat};
-    const auto result = sphere.intersection_with(ray, 0, inf);
-    REQUIRE(result);
-    REQUIRE(result->t == Approx(2));
+    REQUIRE(sphere.intersection_with(ray, 0, inf, record));
+    REQUIRE(record.t == Approx(2));
   }
 }
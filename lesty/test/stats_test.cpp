@@ -0,0 +1,54 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+#include "stats.hpp"
+
+using lesty::Render_stats;
+
+TEST_CASE("Render stats", "[stats]")
+{
+  lesty::reset_global_stats();
+
+  SECTION("Adds up counters")
+  {
+    Render_stats a;
+    a.rays_per_depth[0] = 2;
+    a.rays_per_depth[1] = 1;
+    a.primitive_tests[Render_stats::sphere] = 5;
+    Render_stats b;
+    b.rays_per_depth[0] = 3;
+    b.bvh_node_visits = 7;
+
+    a += b;
+    REQUIRE(a.total_rays() == 6);
+    REQUIRE(a.bvh_node_visits == 7);
+    REQUIRE(a.primitive_tests[Render_stats::sphere] == 5);
+  }
+
+  SECTION("Merges the counters of all threads when they are flushed")
+  {
+    const auto count_rays = [] {
+      ++lesty::thread_stats().rays_per_depth[0];
+      lesty::flush_thread_stats();
+    };
+    std::thread first{count_rays};
+    std::thread second{count_rays};
+    first.join();
+    second.join();
+
+    REQUIRE(lesty::global_stats().total_rays() == 2);
+    REQUIRE(lesty::thread_stats().total_rays() == 0);
+  }
+
+  SECTION("Reports rates as JSON")
+  {
+    Render_stats stats;
+    stats.rays_per_depth[0] = 10;
+    stats.bvh_node_visits = 40;
+    const auto json =
+        lesty::stats_to_json(stats, std::chrono::duration<double>{2});
+    REQUIRE(json.find("\"rays_per_second\": 5.0") != std::string::npos);
+    REQUIRE(json.find("\"bvh_node_visits_per_ray\": 4.0") != std::string::npos);
+  }
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include "texture.hpp"
+
+using lesty::Color;
+using lesty::Texture;
+
+namespace {
+
+// A checkerboard of black and white texels
+auto checkerboard(std::size_t size) -> std::vector<Color>
+{
+  std::vector<Color> pixels(size * size);
+  for (std::size_t y = 0; y < size; ++y) {
+    for (std::size_t x = 0; x < size; ++x) {
+      const float value = (x + y) % 2 == 0 ? 1.f : 0.f;
+      pixels[y * size + x] = Color{value, value, value};
+    }
+  }
+  return pixels;
+}
+
+} // anonymous namespace
+
+TEST_CASE("sRGB decoding", "[texture]")
+{
+  REQUIRE(lesty::srgb8_to_linear(0) == 0);
+  REQUIRE(lesty::srgb8_to_linear(255) == Approx(1));
+  REQUIRE(lesty::srgb8_to_linear(188) == Approx(0.5).epsilon(0.01));
+}
+
+TEST_CASE("Texture mip levels", "[texture]")
+{
+  const auto pixels = checkerboard(16);
+  const Texture texture{16, 16, pixels, Texture::Format::linear_float};
+  REQUIRE(texture.level_count() == 5);
+
+  SECTION("Tiny footprints look up the finest level")
+  {
+    // The center of the top left texel, which is white
+    const auto color = texture.lookup({0.5f / 16, 1 - 0.5f / 16}, 0);
+    REQUIRE(color.r == Approx(1));
+    REQUIRE(texture.lookup({1.5f / 16, 1 - 0.5f / 16}, 0).r ==
+            Approx(0).margin(1e-6));
+  }
+
+  SECTION("Large footprints average the texels")
+  {
+    const auto color = texture.lookup({0.3f, 0.7f}, 1);
+    REQUIRE(color.r == Approx(0.5f));
+    REQUIRE(color.g == Approx(0.5f));
+  }
+
+  SECTION("Coordinates wrap around")
+  {
+    const auto color = texture.lookup({0.5f / 16, 0.5f / 16}, 0);
+    const auto wrapped = texture.lookup({2 + 0.5f / 16, -1 + 0.5f / 16}, 0);
+    REQUIRE(wrapped.r == Approx(color.r));
+  }
+}
+
+TEST_CASE("sRGB textures", "[texture]")
+{
+  const std::vector<Color> pixels(12 * 10, Color{0.2f, 0.4f, 0.6f});
+  const Texture texture{12, 10, pixels, Texture::Format::srgb8};
+  REQUIRE(texture.level_count() == 4);
+
+  // Quantizing to 8 bits loses a little precision
+  for (const float footprint : {0.f, 0.1f, 0.5f, 1.f}) {
+    const auto color = texture.lookup({0.42f, 0.17f}, footprint);
+    REQUIRE(color.r == Approx(0.2f).epsilon(0.02));
+    REQUIRE(color.g == Approx(0.4f).epsilon(0.02));
+    REQUIRE(color.b == Approx(0.6f).epsilon(0.02));
+  }
+}
+
+TEST_CASE("Texture memory budget", "[texture]")
+{
+  lesty::Arena arena;
+  const std::vector<Color> large_pixels(64 * 64);
+  const std::vector<Color> small_pixels(16 * 16);
+
+  std::vector<lesty::Arena_ptr<Texture>> textures;
+  textures.push_back(
+      arena.make<Texture>(64, 64, large_pixels, Texture::Format::srgb8));
+  textures.push_back(
+      arena.make<Texture>(16, 16, small_pixels, Texture::Format::srgb8));
+
+  // Each level is padded to whole tiles of 8x8 texels
+  REQUIRE(textures[1]->memory_size() == (256 + 4 * 64) * 4);
+
+  SECTION("Textures that fit keep all of their levels")
+  {
+    lesty::fit_memory_budget(textures, 1 << 20);
+    REQUIRE(textures[0]->first_level() == 0);
+    REQUIRE(textures[1]->first_level() == 0);
+  }
+
+  SECTION("The largest texture loses its finest levels first")
+  {
+    lesty::fit_memory_budget(textures, 8000);
+    REQUIRE(textures[0]->first_level() == 2);
+    REQUIRE(textures[1]->first_level() == 0);
+    REQUIRE(textures[0]->memory_size() + textures[1]->memory_size() <=
+            8000);
+  }
+}
@@ -0,0 +1,48 @@
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include "tracing.hpp"
+
+TEST_CASE("Tracing", "[tracing]")
+{
+  const auto path =
+      std::filesystem::temp_directory_path() / "lesty_test_trace.json";
+  const auto read_trace = [&path] {
+    std::ifstream file{path};
+    return std::string{std::istreambuf_iterator<char>{file}, {}};
+  };
+
+  SECTION("Records zones of all threads between start and write")
+  {
+    lesty::start_tracing();
+    {
+      const lesty::Trace_scope scope{"main_zone"};
+    }
+    std::thread{[] {
+      const lesty::Trace_scope scope{"thread_zone", {{"x", 1}}};
+    }}.join();
+    lesty::write_trace(path.string());
+
+    const auto trace = read_trace();
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("\"main_zone\"") != std::string::npos);
+    REQUIRE(trace.find("\"thread_zone\"") != std::string::npos);
+    REQUIRE(trace.find("\"args\":{\"x\":1}") != std::string::npos);
+  }
+
+  SECTION("Does not record zones outside of a trace")
+  {
+    lesty::start_tracing();
+    lesty::write_trace(path.string());
+    {
+      const lesty::Trace_scope scope{"late_zone"};
+    }
+    lesty::start_tracing();
+    lesty::write_trace(path.string());
+    REQUIRE(read_trace().find("late_zone") == std::string::npos);
+  }
+}
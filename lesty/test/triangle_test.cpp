@@ -2,7 +2,7 @@
 
 #include "triangle.hpp"
 
-static const lesty::Lambertian dummy_mat{lesty::Color(0.5f, 0.5f, 0.5f)};
+static constexpr std::uint32_t dummy_mat = 0;
 static constexpr float inf = std::numeric_limits<float>::infinity();
 
 TEST_CASE("AABBs for triangle", "[geometry] [AABB] [triangle]")
@@ -24,11 +24,11 @@ TEST_CASE("Ray-Triangle intersection", "[geometry] [triangle]")
 
       THEN("Intersect at (0, 0, 0)")
       {
-        const auto hit_record = tri.intersection_with(r, 0, inf);
-        REQUIRE(hit_record);
-        REQUIRE(hit_record->t == Approx(2));
-        REQUIRE(hit_record->point == beyond::Point3(0, 0, 0));
-        REQUIRE(hit_record->normal == beyond::Point3(0, 0, 1));
+        lesty::HitRecord hit_record;
+        REQUIRE(tri.intersection_with(r, 0, inf, hit_record));
+        REQUIRE(hit_record.t == Approx(2));
+        REQUIRE(hit_record.point == beyond::Point3(0, 0, 0));
+        REQUIRE(hit_record.normal == beyond::Point3(0, 0, 1));
       }
     }
 
@@ -37,8 +37,8 @@ TEST_CASE("Ray-Triangle intersection", "[geometry] [triangle]")
       const lesty::Ray r({-1, 1, -2}, {0, 0, 1});
       THEN("The triangle tri and ray r do not intersect")
       {
-        const auto hit_record = tri.intersection_with(r, 0, inf);
-        REQUIRE(!hit_record);
+        lesty::HitRecord hit_record;
+        REQUIRE(!tri.intersection_with(r, 0, inf, hit_record));
       }
     }
 
@@ -47,8 +47,8 @@ TEST_CASE("Ray-Triangle intersection", "[geometry] [triangle]")
       const lesty::Ray r({1, 1, -2}, {0, 0, 1});
       THEN("The triangle tri and ray r do not intersect")
       {
-        const auto hit_record = tri.intersection_with(r, 0, inf);
-        REQUIRE(!hit_record);
+        lesty::HitRecord hit_record;
+        REQUIRE(!tri.intersection_with(r, 0, inf, hit_record));
       }
     }
 
@@ -57,8 +57,8 @@ TEST_CASE("Ray-Triangle intersection", "[geometry] [triangle]")
       const lesty::Ray r({0, -1, -2}, {0, 0, 1});
       THEN("The triangle tri and ray r do not intersect")
       {
-        const auto hit_record = tri.intersection_with(r, 0, inf);
-        REQUIRE(!hit_record);
+        lesty::HitRecord hit_record;
+        REQUIRE(!tri.intersection_with(r, 0, inf, hit_record));
       }
     }
   }